@@ -0,0 +1,266 @@
+//
+// Created by pallas athena on 16/9/29.
+//
+
+#ifndef _ANTI_ALIAS_HPP
+#define _ANTI_ALIAS_HPP
+
+#include <cstdlib>
+#include <string>
+
+#include "myGL.hpp"
+#include "GpuTimer.hpp"
+#include "RenderTarget.hpp"
+
+
+/* where & how edges get smoothed */
+enum class AntiAliasTechnique {
+    None,          // single-sampled window framebuffer
+    WindowMsaa,    // multisampled window framebuffer via GLFW_SAMPLES; resolved implicitly on swap
+    OffscreenMsaa, // multisampled render target resolved with explicit glBlitFramebuffer calls
+    Fxaa           // single-sampled render target filtered by a full-screen FXAA pass
+};
+
+struct AntiAliasMode {
+    AntiAliasTechnique technique;
+    GLsizei samples; // 2, 4 or 8 for the msaa techniques; ignored otherwise
+
+    static AntiAliasMode none() { return AntiAliasMode{AntiAliasTechnique::None, 0}; };
+    static AntiAliasMode windowMsaa(GLsizei samples) { return AntiAliasMode{AntiAliasTechnique::WindowMsaa, samples}; };
+    static AntiAliasMode offscreenMsaa(GLsizei samples) {
+        return AntiAliasMode{AntiAliasTechnique::OffscreenMsaa, samples};
+    };
+    static AntiAliasMode fxaa() { return AntiAliasMode{AntiAliasTechnique::Fxaa, 0}; };
+
+    /* "none", "msaa2/4/8" (window), "offscreen2/4/8" or "fxaa"; exits on anything else */
+    static AntiAliasMode parse(const std::string& name) {
+        if (name == "none") return none();
+        if (name == "fxaa") return fxaa();
+        for (GLsizei samples : {2, 4, 8}) {
+            if (name == "msaa" + std::to_string(samples)) return windowMsaa(samples);
+            if (name == "offscreen" + std::to_string(samples)) return offscreenMsaa(samples);
+        }
+        std::cerr << "Unknown anti-aliasing mode " + name + "; expected none, msaa2/4/8, offscreen2/4/8 or fxaa"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    };
+
+    std::string name() const {
+        switch (this->technique) {
+            case AntiAliasTechnique::WindowMsaa: return "window msaa " + std::to_string(this->samples) + "x";
+            case AntiAliasTechnique::OffscreenMsaa: return "offscreen msaa " + std::to_string(this->samples) + "x";
+            case AntiAliasTechnique::Fxaa: return "fxaa";
+            default: return "none";
+        }
+    };
+};
+
+
+/* full-screen triangle generated from gl_VertexID; no vertex buffer */
+static const char* const FXAA_VERTEX_SHADER = R"(#version 330 core
+
+out vec2 uv;
+
+void main(){
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+/* FXAA in the spirit of Lottes' "console" variant: one luma gradient search along the edge direction */
+static const char* const FXAA_FRAGMENT_SHADER = R"(#version 330 core
+
+in vec2 uv;
+out vec4 color;
+
+uniform sampler2D scene;
+uniform vec2 rcpFrame; // 1 / storage size
+uniform vec2 uvScale;  // logical size / storage size
+
+const float REDUCE_MIN = 1.0 / 128.0;
+const float REDUCE_MUL = 1.0 / 8.0;
+const float SPAN_MAX = 8.0;
+
+vec3 fetch(vec2 p) {
+    // storage may be larger than the rendered area; never read outside of it
+    return texture(scene, clamp(p, 0.5 * rcpFrame, uvScale - 0.5 * rcpFrame)).rgb;
+}
+
+float luma(vec3 rgb) {
+    return dot(rgb, vec3(0.299, 0.587, 0.114));
+}
+
+void main()
+{
+    vec2 p = uv * uvScale;
+    vec3 rgbM = fetch(p);
+    float lumaNW = luma(fetch(p + vec2(-1.0, -1.0) * rcpFrame));
+    float lumaNE = luma(fetch(p + vec2(1.0, -1.0) * rcpFrame));
+    float lumaSW = luma(fetch(p + vec2(-1.0, 1.0) * rcpFrame));
+    float lumaSE = luma(fetch(p + vec2(1.0, 1.0) * rcpFrame));
+    float lumaM = luma(rgbM);
+
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * rcpFrame;
+
+    vec3 rgbA = 0.5 * (fetch(p + dir * (1.0 / 3.0 - 0.5)) + fetch(p + dir * (2.0 / 3.0 - 0.5)));
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (fetch(p - dir * 0.5) + fetch(p + dir * 0.5));
+    float lumaB = luma(rgbB);
+
+    color = vec4(lumaB < lumaMin || lumaB > lumaMax ? rgbA : rgbB, 1.0);
+}
+)";
+
+
+/* selectable anti-aliasing around the scene drawing of a frame: begin() redirects drawing to an offscreen target
+ * when the technique needs one, end() resolves it into the window framebuffer. the gpu time of scene plus resolve is
+ * measured per frame. gl calls require the owning context to be current. */
+class AntiAliasing {
+private:
+    AntiAliasMode m_mode;
+    size_t m_target = 0; // id in the render target manager
+    size_t m_resolveTarget = 0; // offscreen msaa; single-sampled, same format as m_target
+    bool m_initialized = false;
+
+    GLuint m_program = 0; // fxaa
+    GLuint m_vertexArray = 0; // empty; core profile needs one bound to draw
+    GLint m_rcpFrameLocation = -1;
+    GLint m_uvScaleLocation = -1;
+
+    GpuTimer m_timer;
+
+public:
+    AntiAliasing(AntiAliasMode mode = AntiAliasMode::windowMsaa(4)) : m_mode(mode) {};
+
+    ~AntiAliasing(){};
+
+public:
+    /* changes take effect on the next window */
+    void setMode(AntiAliasMode mode) {
+        assert(!this->m_initialized);
+        this->m_mode = mode;
+    };
+
+    const AntiAliasMode& mode() const {
+        return this->m_mode;
+    };
+
+    /* value for the GLFW_SAMPLES window hint */
+    int windowSamples() const {
+        return this->m_mode.technique == AntiAliasTechnique::WindowMsaa ? this->m_mode.samples : 0;
+    };
+
+    bool offscreen() const {
+        return this->m_mode.technique == AntiAliasTechnique::OffscreenMsaa ||
+               this->m_mode.technique == AntiAliasTechnique::Fxaa;
+    };
+
+public:
+    void initialize(RenderTargetManager& targets) {
+        if (this->m_mode.technique == AntiAliasTechnique::OffscreenMsaa) {
+            this->m_target = targets.create(
+                    RenderTargetDescription{GL_RGBA8, GL_DEPTH24_STENCIL8, this->m_mode.samples, 1.0f});
+            this->m_resolveTarget = targets.create(RenderTargetDescription{GL_RGBA8, 0, 0, 1.0f});
+        } else if (this->m_mode.technique == AntiAliasTechnique::Fxaa) {
+            this->m_target = targets.create(RenderTargetDescription{GL_RGBA8, GL_DEPTH24_STENCIL8, 0, 1.0f});
+
+            this->m_program = compileShaderSources(FXAA_VERTEX_SHADER, FXAA_FRAGMENT_SHADER);
+            this->m_rcpFrameLocation = glGetUniformLocation(this->m_program, "rcpFrame");
+            this->m_uvScaleLocation = glGetUniformLocation(this->m_program, "uvScale");
+            glGenVertexArrays(1, &this->m_vertexArray);
+        }
+        this->m_initialized = true;
+    };
+
+    /* before the scene is drawn; viewport is where the scene goes within the framebuffer */
+    void begin(RenderTargetManager& targets, const GLint* viewport) {
+        this->m_timer.begin();
+        if (!this->offscreen()) return;
+
+        targets.bind(this->m_target);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    };
+
+    /* after the scene is drawn; leaves the window framebuffer bound with the scene viewport */
+    void end(RenderTargetManager& targets, GLsizei width, GLsizei height, const GLint* viewport) {
+        if (this->offscreen()) {
+            const RenderTarget& target = targets.acquire(this->m_target);
+
+            if (this->m_mode.technique == AntiAliasTechnique::OffscreenMsaa) {
+                // a blit out of a multisampled buffer fails unless both formats match, and the window's may be sRGB
+                // or 10 bit; resolve into a target of the same format first, then copy that into the window
+                const RenderTarget& resolve = targets.acquire(this->m_resolveTarget);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve.framebuffer);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, resolve.framebuffer);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            } else {
+                // the pass replaces program, vertex array, unit 0's texture & depth state; all are put back below
+                GLint program, vertex_array, active_texture, texture;
+                GLboolean depth_test, depth_mask;
+                glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+                glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertex_array);
+                glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture);
+                glActiveTexture(GL_TEXTURE0);
+                glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+                depth_test = glIsEnabled(GL_DEPTH_TEST);
+                glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+
+                // the full-screen triangle must not be depth tested against, or write into, the window's depth
+                glDisable(GL_DEPTH_TEST);
+                glDepthMask(GL_FALSE);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glViewport(0, 0, width, height);
+                glUseProgram(this->m_program);
+                glUniform2f(this->m_rcpFrameLocation, 1.0f / target.allocatedWidth, 1.0f / target.allocatedHeight);
+                glUniform2f(this->m_uvScaleLocation, float(target.width) / target.allocatedWidth,
+                            float(target.height) / target.allocatedHeight);
+                glBindTexture(GL_TEXTURE_2D, target.color);
+                glBindVertexArray(this->m_vertexArray);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+
+                // the demos set their program, VAO & textures once in initialize()
+                glBindTexture(GL_TEXTURE_2D, GLuint(texture));
+                glActiveTexture(GLenum(active_texture));
+                glUseProgram(GLuint(program));
+                glBindVertexArray(GLuint(vertex_array));
+                glDepthMask(depth_mask);
+                if (depth_test) glEnable(GL_DEPTH_TEST);
+            }
+
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        }
+        this->m_timer.end();
+    };
+
+    void destroy() {
+        if (this->m_program) glDeleteProgram(this->m_program);
+        if (this->m_vertexArray) glDeleteVertexArrays(1, &this->m_vertexArray);
+        this->m_program = this->m_vertexArray = 0;
+        this->m_timer.destroy();
+        this->m_initialized = false;
+    };
+
+public:
+    const GpuTimer& timer() const {
+        return this->m_timer;
+    };
+
+    void report(std::ostream& out) const {
+        out << this->m_mode.name() << ": " << this->m_timer.averageMs() << " ms gpu avg, " << this->m_timer.maxMs()
+            << " ms max over " << this->m_timer.samples() << " frames" << std::endl;
+    };
+};
+
+
+#endif //_ANTI_ALIAS_HPP
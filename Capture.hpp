@@ -0,0 +1,317 @@
+//
+// Created by pallas athena on 16/9/27.
+//
+
+#ifndef _CAPTURE_HPP
+#define _CAPTURE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "myGL.hpp"
+
+#ifndef MYGL_NO_OPENCV
+#include <opencv2/imgproc/imgproc.hpp>
+#endif
+
+
+/* one captured frame; RGBA8 rows bottom-up as glReadPixels returns them */
+struct CapturedFrame {
+    unsigned long index;
+    GLsizei width;
+    GLsizei height;
+    std::vector<unsigned char> pixels;
+};
+
+
+/* consumers of captured frames, run on the capture thread */
+namespace capture_sinks {
+    /* raw RGBA frames appended to one file; e.g. ffmpeg -f rawvideo -pix_fmt rgba -s WxH -i file -vf vflip out.mp4 */
+    inline std::function<void(const CapturedFrame&)> rawFile(const std::string& file) {
+        std::shared_ptr<FILE> out(std::fopen(file.c_str(), "wb"), [](FILE* f) { if (f) std::fclose(f); });
+        if (!out) {
+            std::cerr << "Unable to open capture file: " + file << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return [out](const CapturedFrame& frame) {
+            std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), out.get());
+        };
+    };
+
+    /* raw RGBA frames written to the stdin of an encoder process, e.g.
+     * "ffmpeg -y -f rawvideo -pix_fmt rgba -s 600x480 -r 60 -i - -vf vflip out.mp4" */
+    inline std::function<void(const CapturedFrame&)> pipe(const std::string& command) {
+        std::shared_ptr<FILE> out(popen(command.c_str(), "w"), [](FILE* f) { if (f) pclose(f); });
+        if (!out) {
+            std::cerr << "Unable to start encoder: " + command << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return [out](const CapturedFrame& frame) {
+            std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), out.get());
+        };
+    };
+
+#ifndef MYGL_NO_OPENCV
+    /* numbered png files; prefix "capture/frame_" gives capture/frame_000000.png, ... */
+    inline std::function<void(const CapturedFrame&)> pngSequence(const std::string& prefix) {
+        return [prefix](const CapturedFrame& frame) {
+            cv::Mat rgba(frame.height, frame.width, CV_8UC4, const_cast<unsigned char*>(frame.pixels.data()));
+            cv::Mat bgr;
+            cv::cvtColor(rgba, bgr, cv::COLOR_RGBA2BGR);
+            cv::flip(bgr, bgr, 0); // opengl rows are bottom-up
+            char number[16];
+            std::snprintf(number, sizeof(number), "%06lu", frame.index);
+            cv::imwrite(prefix + number + ".png", bgr);
+        };
+    };
+#endif
+
+    /* sink named by a "raw:file", "png:prefix" or "pipe:command" spec, as in MYGL_CAPTURE */
+    inline std::function<void(const CapturedFrame&)> parse(const std::string& spec) {
+        size_t colon = spec.find(':');
+        std::string kind = spec.substr(0, colon), argument = colon == std::string::npos ? "" : spec.substr(colon + 1);
+        if (!argument.empty()) {
+            if (kind == "raw") return rawFile(argument);
+            if (kind == "pipe") return pipe(argument);
+            if (kind == "png") {
+#ifndef MYGL_NO_OPENCV
+                return pngSequence(argument);
+#else
+                std::cerr << "Unable to capture png files: built without OpenCV" << std::endl;
+                exit(EXIT_FAILURE);
+#endif
+            }
+        }
+        std::cerr << "Invalid capture spec " + spec + "; expected raw:file, png:prefix or pipe:command" << std::endl;
+        exit(EXIT_FAILURE);
+    };
+};
+
+
+/* asynchronous framebuffer readback: each frame is read into the next of a ring of pixel pack buffers, and mapped
+ * only ring-size - 1 frames later once its fence has signaled, so neither glReadPixels nor the map waits for the
+ * gpu. mapped frames are copied into a queue drained by a consumer thread; when the queue is full the render thread
+ * waits for the sink, unless frames may be dropped instead. gl calls require the owning context to be current; call
+ * capture() after draw() and before swapping buffers. */
+class FrameCapture {
+public:
+    typedef std::function<void(const CapturedFrame&)> Sink;
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        GLsync fence = 0;
+        unsigned long index = 0;
+        GLsizei width = 0;
+        GLsizei height = 0;
+    };
+
+    std::vector<Slot> m_ring;
+    size_t m_next = 0; // slot to read the next frame into
+    unsigned long m_frames = 0;
+
+    /* consumer thread */
+    Sink m_sink;
+    std::thread m_consumer;
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::condition_variable m_drained;
+    std::condition_variable m_space; // a frame left the queue
+    std::deque<CapturedFrame> m_queue;
+    size_t m_maxQueued;
+    bool m_dropFrames; // drop rather than wait when the queue is full
+    bool m_quit = false;
+
+    /* statistics */
+    unsigned long m_captured = 0;
+    unsigned long m_stalls = 0; // fences not yet signaled when the slot came round; the map had to wait
+    unsigned long m_dropped = 0; // frames dropped because the consumer fell behind
+    unsigned long m_throttled = 0; // frames that waited for room in the queue
+    std::chrono::steady_clock::duration m_throttleTime = std::chrono::steady_clock::duration::zero();
+    unsigned long long m_bytes = 0;
+    std::chrono::steady_clock::duration m_mapTime = std::chrono::steady_clock::duration::zero();
+
+public:
+    /* ring of 3 allows two frames in flight; max_queued bounds memory when the sink is slower than rendering, by
+     * slowing rendering down to the sink or, with drop_frames, by losing frames */
+    FrameCapture(Sink sink, size_t ring_size = 3, size_t max_queued = 16, bool drop_frames = false) :
+            m_ring(ring_size), m_sink(sink), m_maxQueued(max_queued), m_dropFrames(drop_frames) {
+        if (ring_size == 0 || max_queued == 0) {
+            std::cerr << "Unable to capture: ring size and queue length must be at least 1" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        this->m_consumer = std::thread([this]() { this->consume(); });
+    };
+
+    ~FrameCapture() {
+        // gl objects can only be deleted with a current context; finish() is the caller's duty
+        assert(this->m_ring.empty() || this->m_ring[0].buffer == 0);
+        this->stopConsumer();
+    };
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+public:
+    /* queue a readback of the read framebuffer region (x, y, width, height) and collect the oldest finished one */
+    void capture(GLint x, GLint y, GLsizei width, GLsizei height) {
+        Slot& slot = this->m_ring[this->m_next];
+        if (slot.fence) this->collect(slot); // ring full; this slot's frame is the oldest one in flight
+
+        GLsizeiptr size = GLsizeiptr(width) * height * 4;
+        if (slot.buffer == 0) glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        if (slot.width != width || slot.height != height) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        }
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0); // returns without waiting
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.index = this->m_frames++;
+        slot.width = width;
+        slot.height = height;
+
+        this->m_next = (this->m_next + 1) % this->m_ring.size();
+    };
+
+    /* collect every frame in flight, wait for the consumer and delete gl objects */
+    void finish() {
+        for (size_t i = 0; i < this->m_ring.size(); ++i) {
+            Slot& slot = this->m_ring[(this->m_next + i) % this->m_ring.size()];
+            if (slot.fence) this->collect(slot);
+        }
+        for (Slot& slot : this->m_ring) {
+            if (slot.buffer) glDeleteBuffers(1, &slot.buffer);
+            slot.buffer = 0;
+        }
+
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        this->m_drained.wait(lock, [this]() { return this->m_queue.empty(); });
+    };
+
+public:
+    unsigned long capturedFrames() const {
+        return this->m_captured;
+    };
+
+    unsigned long stalledFrames() const {
+        return this->m_stalls;
+    };
+
+    unsigned long droppedFrames() const {
+        return this->m_dropped;
+    };
+
+    unsigned long throttledFrames() const {
+        return this->m_throttled;
+    };
+
+    /* readback bandwidth as seen by the render thread: bytes over time spent mapping & copying */
+    double bandwidthMBps() const {
+        double seconds = std::chrono::duration<double>(this->m_mapTime).count();
+        return seconds == 0.0 ? 0.0 : this->m_bytes / seconds / 1e6;
+    };
+
+    void report(std::ostream& out) const {
+        out << this->m_captured << " frames captured, " << this->m_stalls << " stalled, " << this->m_dropped
+            << " dropped, " << this->m_throttled << " throttled ("
+            << std::chrono::duration<double, std::milli>(this->m_throttleTime).count() << " ms waiting for the sink); "
+            << this->m_bytes / 1e6 << " MB read back at " << this->bandwidthMBps() << " MB/s" << std::endl;
+    };
+
+private:
+    /* map a slot's buffer and hand a copy of the frame to the consumer */
+    void collect(Slot& slot) {
+        timeline::Zone zone("FrameCapture::collect");
+        auto start = std::chrono::steady_clock::now();
+
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            ++this->m_stalls;
+            glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000)); // 1 s at most
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+
+        CapturedFrame frame;
+        frame.index = slot.index;
+        frame.width = slot.width;
+        frame.height = slot.height;
+        size_t size = size_t(slot.width) * slot.height * 4;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(size), GL_MAP_READ_BIT);
+        if (pixels) {
+            frame.pixels.assign(static_cast<const unsigned char*>(pixels),
+                                static_cast<const unsigned char*>(pixels) + size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        this->m_mapTime += std::chrono::steady_clock::now() - start;
+        if (!pixels) return;
+        this->m_bytes += size;
+        ++this->m_captured;
+
+        {
+            std::unique_lock<std::mutex> lock(this->m_mutex);
+            if (this->m_queue.size() >= this->m_maxQueued) {
+                if (this->m_dropFrames) {
+                    ++this->m_dropped;
+                    return;
+                }
+                timeline::Zone throttle_zone("FrameCapture::throttle");
+                auto wait_start = std::chrono::steady_clock::now();
+                this->m_space.wait(lock, [this]() { return this->m_queue.size() < this->m_maxQueued; });
+                this->m_throttleTime += std::chrono::steady_clock::now() - wait_start;
+                ++this->m_throttled;
+            }
+            this->m_queue.push_back(std::move(frame));
+        }
+        this->m_ready.notify_one();
+    };
+
+    void consume() {
+        timeline::setThreadName("capture");
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        while (true) {
+            this->m_ready.wait(lock, [this]() { return this->m_quit || !this->m_queue.empty(); });
+            if (this->m_queue.empty()) return; // quit with nothing left
+
+            CapturedFrame frame = std::move(this->m_queue.front());
+            lock.unlock();
+            {
+                timeline::Zone zone("captureSink");
+                this->m_sink(frame);
+            }
+            lock.lock();
+
+            this->m_queue.pop_front();
+            this->m_space.notify_one();
+            if (this->m_queue.empty()) this->m_drained.notify_all();
+        }
+    };
+
+    void stopConsumer() {
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_quit = true;
+        }
+        this->m_ready.notify_all();
+        if (this->m_consumer.joinable()) this->m_consumer.join();
+    };
+};
+
+
+#endif //_CAPTURE_HPP
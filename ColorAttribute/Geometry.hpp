@@ -1,5 +1,5 @@
-#ifndef _GEOMETRY_HPP
-#define _GEOMETRY_HPP
+#ifndef _COLOR_ATTRIBUTE_GEOMETRY_HPP
+#define _COLOR_ATTRIBUTE_GEOMETRY_HPP
 
 #include <cassert>
 #include <vector>
@@ -0,0 +1,26 @@
+#version 330 core
+
+in vec2 uv;
+
+uniform sampler2D source;
+uniform vec2 uvScale;
+uniform vec2 direction; // one texel along the blur axis, in texture coordinates
+
+// Ouput data
+out vec4 color;
+
+void main()
+{
+
+	// 9-tap gaussian, separable; taps stay on the centers of the outermost logical texels, as linear filtering any
+	// further out would blend in the unused part of the storage
+	const float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+	vec2 texel = 1.0 / vec2(textureSize(source, 0));
+	vec2 low = 0.5 * texel, high = uvScale - 0.5 * texel;
+	vec2 center = uv * uvScale;
+	color = texture(source, center) * weights[0];
+	for (int i = 1; i < 5; ++i) {
+		color += texture(source, clamp(center + direction * i, low, high)) * weights[i];
+		color += texture(source, clamp(center - direction * i, low, high)) * weights[i];
+	}
+}
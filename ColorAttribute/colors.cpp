@@ -1,6 +1,9 @@
 #include "../myGL.hpp"
 #include "Geometry.hpp"
 #include "../Context.hpp"
+#include "../RenderGraph.hpp"
+#include "../Resource.hpp"
+#include "../VertexPulling.hpp"
 
 
 /* Constants. */
@@ -9,6 +12,8 @@ static const GLint height = 480;
 
 const std::string vertex_shader_file = "plane.vert";
 const std::string fragment_shader_file = "smooth_color.frag";
+const std::string pulling_vertex_shader_file = "colored_polygon.vert";
+const std::string fullscreen_vertex_shader_file = "fullscreen.vert";
 
 /* triangle data */
 std::vector<GLfloat> vertex_data;
@@ -19,18 +24,40 @@ auto header = coloredTriangle(0.8f, vertex_data);
 class Window : public GLContext {
 
 private:
+    bool pulling; /* bufferless; the triangle is derived in the vertex shader */
+    PolygonPulling polygons;
+
     GLuint vertex_array; /* VAO object */
-    GLuint vertex_buffer; /* VBO object */
+    ResourcePool resources; /* pooled gl objects */
+    PooledBuffer vertex_buffer; /* VBO object */
     GLuint program_id; /* shaders */
 
+    /* glow post-processing as a render graph: scene -> downsample -> blur x -> blur y -> composite */
+    bool glow;
+    RenderGraph graph{render_targets};
+    GLuint fullscreen_array = 0; /* empty VAO for the full-screen passes */
+    GLuint downsample_program = 0, blur_program = 0, composite_program = 0;
+
+public:
+    Window(bool pulling, bool glow) : pulling(pulling), glow(glow) {};
+
+private:
     void initialize() {
-        /* create VBO object */
-        glGenBuffers(1, &vertex_buffer);
-        {
-            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-            glBufferData(GL_ARRAY_BUFFER, header.bufferSize(), header.bufferData(), GL_STATIC_DRAW);
+        initializeScene();
+        if (glow) initializeGlow();
+    };
+
+    void initializeScene() {
+        if (pulling) {
+            program_id = compileShaders(pulling_vertex_shader_file, fragment_shader_file);
+            polygons.initialize(program_id);
+            return;
         }
 
+        /* create VBO object */
+        vertex_buffer = resources.acquireBuffer(ResourceCategory::Vertex, header.bufferSize(), header.bufferData());
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer.name);
+
         /* create VAO object */
         glGenVertexArrays(1, &vertex_array);
         {
@@ -64,7 +91,97 @@ private:
         glUseProgram(program_id);
     };
 
-    void draw() {
+    void initializeGlow() {
+        const RenderTargetDescription full = {GL_RGBA8, GL_DEPTH24_STENCIL8, 0, 1.0f};
+        const RenderTargetDescription half = {GL_RGBA8, 0, 0, 0.5f};
+        RenderGraph::Resource scene = graph.createTarget("scene", full);
+        RenderGraph::Resource downsampled = graph.createTarget("downsampled", half);
+        RenderGraph::Resource blurred_x = graph.createTarget("blurred x", half);
+        RenderGraph::Resource blurred_y = graph.createTarget("blurred y", half); // aliases downsampled
+        RenderGraph::Resource quarter = graph.createTarget("quarter", {GL_RGBA8, 0, 0, 0.25f});
+        RenderGraph::Resource window = graph.importFramebuffer("window");
+
+        downsample_program = compileShaders(fullscreen_vertex_shader_file, "downsample.frag");
+        blur_program = compileShaders(fullscreen_vertex_shader_file, "blur.frag");
+        composite_program = compileShaders(fullscreen_vertex_shader_file, "composite.frag");
+        glGenVertexArrays(1, &fullscreen_array);
+
+        RenderGraph::Pass pass = graph.addPass("scene", [this, scene](RenderGraph& graph) {
+            graph.bind(scene);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawScene();
+        });
+        graph.write(pass, scene);
+
+        pass = graph.addPass("downsample", [this, scene, downsampled](RenderGraph& graph) {
+            fullscreen(graph, downsampled, downsample_program, {{"source", graph.target(scene)}});
+        });
+        graph.read(pass, scene);
+        graph.write(pass, downsampled);
+
+        pass = graph.addPass("blur x", [this, downsampled, blurred_x](RenderGraph& graph) {
+            const RenderTarget& source = graph.target(downsampled);
+            glUseProgram(blur_program);
+            glUniform2f(glGetUniformLocation(blur_program, "direction"), 1.0f / source.allocatedWidth, 0.0f);
+            fullscreen(graph, blurred_x, blur_program, {{"source", source}});
+        });
+        graph.read(pass, downsampled);
+        graph.write(pass, blurred_x);
+
+        pass = graph.addPass("blur y", [this, blurred_x, blurred_y](RenderGraph& graph) {
+            const RenderTarget& source = graph.target(blurred_x);
+            glUseProgram(blur_program);
+            glUniform2f(glGetUniformLocation(blur_program, "direction"), 0.0f, 1.0f / source.allocatedHeight);
+            fullscreen(graph, blurred_y, blur_program, {{"source", source}});
+        });
+        graph.read(pass, blurred_x);
+        graph.write(pass, blurred_y);
+
+        // nothing reads it; culled
+        pass = graph.addPass("quarter downsample", [this, blurred_y, quarter](RenderGraph& graph) {
+            fullscreen(graph, quarter, downsample_program, {{"source", graph.target(blurred_y)}});
+        });
+        graph.read(pass, blurred_y);
+        graph.write(pass, quarter);
+
+        pass = graph.addPass("composite", [this, scene, blurred_y, window](RenderGraph& graph) {
+            fullscreen(graph, window, composite_program,
+                       {{"scene", graph.target(scene)}, {"glow", graph.target(blurred_y)}});
+        });
+        graph.read(pass, scene);
+        graph.read(pass, blurred_y);
+        graph.write(pass, window);
+
+        graph.compile();
+    };
+
+    /* one full-screen triangle into destination sampling the inputs; "name" gets texture unit i, "nameUvScale" (or
+     * "uvScale" for a single input) the logical part of the storage */
+    void fullscreen(RenderGraph& graph, RenderGraph::Resource destination, GLuint program,
+                    const std::vector<std::pair<std::string, const RenderTarget&>>& inputs) {
+        glUseProgram(program);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const RenderTarget& input = inputs[i].second;
+            std::string scale = inputs.size() == 1 ? "uvScale" : inputs[i].first + "UvScale";
+            glActiveTexture(GLenum(GL_TEXTURE0 + i));
+            glBindTexture(GL_TEXTURE_2D, input.color);
+            glUniform1i(glGetUniformLocation(program, inputs[i].first.c_str()), GLint(i));
+            glUniform2f(glGetUniformLocation(program, scale.c_str()), float(input.width) / input.allocatedWidth,
+                        float(input.height) / input.allocatedHeight);
+        }
+        graph.bind(destination);
+        glBindVertexArray(fullscreen_array);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    };
+
+    void drawScene() {
+        if (pulling) {
+            polygons.draw(0.8f, 3);
+            return;
+        }
+
+        glUseProgram(program_id);
+        glBindVertexArray(vertex_array);
         glDrawArrays(
                 GL_TRIANGLES, // surfel type
                 0, // starting index
@@ -72,17 +189,40 @@ private:
         );
     };
 
+    void draw() {
+        if (glow) {
+            graph.execute();
+            return;
+        }
+        drawScene();
+    };
+
     void destroy() {
         /* Destroy gl objects */
-        glDeleteBuffers(1, &vertex_buffer);
-        glDeleteVertexArrays(1, &vertex_array);
         glDeleteProgram(program_id);
+        if (glow) {
+            graph.report(std::cout);
+            glDeleteProgram(downsample_program);
+            glDeleteProgram(blur_program);
+            glDeleteProgram(composite_program);
+            glDeleteVertexArrays(1, &fullscreen_array);
+        }
+        if (pulling) {
+            polygons.destroy();
+            return;
+        }
+        resources.releaseBuffer(vertex_buffer);
+        glDeleteVertexArrays(1, &vertex_array);
+
+        resources.statistics().report(std::cout);
+        resources.clear();
     };
 };
 
 
 int main(int argc, char* argv[]) {
-    Window w;
+    /* usage: ColorAttribute [vbo|pulling] [glow]; glow post-processes through a render graph */
+    Window w(argc > 1 && std::string(argv[1]) == "pulling", argc > 2 && std::string(argv[2]) == "glow");
     w.setEnvironment();
     w.createWindow(width, height, "Colorful triangle.");
 
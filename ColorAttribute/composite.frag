@@ -0,0 +1,18 @@
+#version 330 core
+
+in vec2 uv;
+
+uniform sampler2D scene;
+uniform sampler2D glow;
+uniform vec2 sceneUvScale;
+uniform vec2 glowUvScale;
+
+// Ouput data
+out vec4 color;
+
+void main()
+{
+
+	// scene plus its blurred copy as a glow
+	color = texture(scene, uv * sceneUvScale) + 1.5 * texture(glow, uv * glowUvScale);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+in vec2 uv;
+
+// source storage may be larger than its logical size; uvScale = size / allocated size
+uniform sampler2D source;
+uniform vec2 uvScale;
+
+// Ouput data
+out vec4 color;
+
+void main()
+{
+
+	// half size: one bilinear tap averages 2x2 source texels
+	color = texture(source, uv * uvScale);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// full-screen triangle from gl_VertexID; no vertex buffer
+out vec2 uv;
+
+void main(){
+
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
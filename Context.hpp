@@ -5,12 +5,22 @@
 #ifndef _GL_CONTEXT_H
 #define _GL_CONTEXT_H
 
+#include <atomic>
+#include <cstdlib>
 #include <exception>
 #include <string>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include "RenderTarget.hpp" // gl3.h must come before glfw3.h
+#include "AntiAlias.hpp"
 #include <GLFW/glfw3.h>
 
+#include "Capture.hpp"
+#include "FramePacer.hpp"
+#include "Occlusion.hpp"
+
 
 /* exceptions */
 class GLFW3InitError : std::exception {
@@ -30,20 +40,20 @@ public:
 
 /* default callback functions; use free function to avoid std::function targeting problems */
 namespace default_callbacks{
-    void error (int error, const char *description) {
+    inline void error (int error, const char *description) {
         (void)error;
         std::cerr << description << std::endl;
     };
 
-    void key (GLFWwindow *window, int key, int scancode, int action, int mods) {
+    inline void key (GLFWwindow *window, int key, int scancode, int action, int mods) {
         (void)scancode, (void)mods;
         if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
             glfwSetWindowShouldClose(window, GL_TRUE);
     };
 
-    void resize (GLFWwindow *window, int w, int h) {
-        (void) w, (void)h;
-        glfwSwapBuffers(window);
+    inline void resize (GLFWwindow *window, int w, int h) {
+        // framebuffer size changes are handled by the context itself; swapping here would present a stale frame
+        (void)window, (void) w, (void)h;
     };
 };
 
@@ -52,7 +62,48 @@ namespace default_callbacks{
 class GLContext{
 
 private:
-    GLFWwindow* window; // window to hold
+    GLFWwindow* window = nullptr; // window to hold
+    std::string title; // names the render thread on the timeline
+
+    /* framebuffer size in pixels; differs from window size on retina monitors. written by the event thread, read by
+     * the render thread, which may be another one; see renderLoop() */
+    std::atomic<int> framebuffer_width{0};
+    std::atomic<int> framebuffer_height{0};
+    std::atomic<bool> framebuffer_resized{true}; // viewport & size-dependent targets need to be updated
+    int frame_width = 0; // size the current frame is drawn at; render thread only
+    int frame_height = 0;
+    GLint viewport[4] = {0, 0, 0, 0}; // aspect ratio always 1, centered
+
+    /* glfw is initialized once for all contexts alive and terminated with the last one */
+    static std::mutex& libraryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    };
+
+    static int& libraryUsers() {
+        static int users = 0;
+        return users;
+    };
+
+    /* records the new size only; the work is done once at the start of the next frame */
+    static void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
+        GLContext* context = static_cast<GLContext*>(glfwGetWindowUserPointer(window));
+        context->framebuffer_width.store(width, std::memory_order_relaxed);
+        context->framebuffer_height.store(height, std::memory_order_relaxed);
+        context->framebuffer_resized.store(true, std::memory_order_release);
+    };
+
+    void updateViewport() {
+        int _width = this->frame_width, _height = this->frame_height;
+        if (_width >= _height) {
+            this->viewport[0] = (_width - _height) / 2, this->viewport[1] = 0;
+            this->viewport[2] = this->viewport[3] = _height;
+        } else {
+            this->viewport[0] = 0, this->viewport[1] = (_height - _width) / 2;
+            this->viewport[2] = this->viewport[3] = _width;
+        }
+        glViewport(this->viewport[0], this->viewport[1], this->viewport[2], this->viewport[3]);
+    };
 
 public:
     /* callback function signature */
@@ -66,22 +117,31 @@ protected:
     KeyCallback key_callback = default_callbacks::key; // Key Events callbacks
     ResizeCallback window_size_callback = default_callbacks::resize; // Resize callbacks
 
+    FramePacer pacer; // swap interval, frame limiter & frame time metrics
+    RenderTargetManager render_targets; // offscreen targets following the framebuffer size
+    std::unique_ptr<FrameCapture> capture; // readback of every frame; null unless enabled
+    AntiAliasing anti_aliasing; // window msaa 4x unless changed before setEnvironment()
+    GpuTimeline gpu_timeline; // gpu zones on the timeline; only recorded while the timeline is enabled
+    OcclusionCuller occlusion; // proxy tests & conditional rendering of heavy draws; idle unless draw() uses it
+
 public:
-    GLContext(){ // constructor
+    GLContext(){ // constructor; main thread only, as glfw requires
         glfwSetErrorCallback(*(this->error_callback.target<GLFWerrorfun>()));
 
-        /* Initialize GLFW */
-        if (!glfwInit()) { // if initialization failed
+        /* Initialize GLFW; once for every context alive */
+        std::lock_guard<std::mutex> lock(libraryMutex());
+        if (libraryUsers() == 0 && !glfwInit()) { // if initialization failed
             /* Terminate GLFW */
             glfwTerminate();
-            this->window = nullptr;
             throw GLFW3InitError();
         }
+        ++libraryUsers();
     };
 
-    ~GLContext() { // destructor
-        /* Terminate GLFW */
-        glfwTerminate();
+    virtual ~GLContext() { // destructor; main thread only
+        /* Terminate GLFW with the last context */
+        std::lock_guard<std::mutex> lock(libraryMutex());
+        if (--libraryUsers() == 0) glfwTerminate();
         this->window = nullptr;
     };
 
@@ -89,7 +149,8 @@ public:
     virtual void setEnvironment() { // set window & opengl hints
         /* GLFW window hints */
         glfwWindowHint(GLFW_RESIZABLE, GL_TRUE); // Window related hint; others: GLFW_VISIBLE, GLFW_FOCUS
-        glfwWindowHint(GLFW_SAMPLES, 4); // Framebuffer related hint; set multi-sampling/anti-alias
+        // Framebuffer related hint; set multi-sampling/anti-alias. 0 when anti-aliasing is done offscreen
+        glfwWindowHint(GLFW_SAMPLES, this->anti_aliasing.windowSamples());
         glfwWindowHint(GLFW_DOUBLEBUFFER, GL_TRUE); //Framebuffer related hint; set double buffer
 
         /* Below OpenGL API configurations are essential for specified platforms / graphic hardware */
@@ -100,6 +161,8 @@ public:
     };
 
     virtual void createWindow(const GLint width, const GLint height, const std::string& title) { // create window
+        this->title = title;
+
         /* Creating a window and rendering context */
         this->window = glfwCreateWindow(
                 width, // width
@@ -118,13 +181,35 @@ public:
         /* Making the OpenGL context current */
         glfwMakeContextCurrent(this->window);
         /* Waiting interval between swapping buffers; the default value 1 recommended */
-        glfwSwapInterval(1);
+        if (this->pacer.swapInterval() == FramePacer::ADAPTIVE_SWAP_INTERVAL &&
+            !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+            !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+            this->pacer.setSwapInterval(1); // adaptive vsync unsupported; plain vsync instead
+        }
+        glfwSwapInterval(this->pacer.swapInterval());
+
+        /* Monitor refresh rate; frame budget for missed frame detection when not limited by target fps */
+        const GLFWvidmode* video_mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if (video_mode) this->pacer.setRefreshRate(video_mode->refreshRate);
 
         /* Designate Key action event callback */
         glfwSetKeyCallback(this->window, *(this->key_callback.target<GLFWkeyfun>()));
 
         /* Window refresh callback; mainly to force redraw when resizing */
         glfwSetWindowSizeCallback(this->window, *(this->window_size_callback.target<GLFWwindowsizefun>()));
+
+        /* Framebuffer size callback; use frame buffer size instead of windows size for retina monitor adjustment */
+        glfwSetWindowUserPointer(this->window, this);
+        glfwSetFramebufferSizeCallback(this->window, GLContext::framebufferSizeCallback);
+        int framebuffer_width = 0, framebuffer_height = 0;
+        glfwGetFramebufferSize(this->window, &framebuffer_width, &framebuffer_height);
+        framebufferSizeCallback(this->window, framebuffer_width, framebuffer_height);
+    };
+
+    /* main thread only; after the render loop has finished */
+    void destroyWindow() {
+        if (this->window) glfwDestroyWindow(this->window);
+        this->window = nullptr;
     };
 
 protected:
@@ -142,34 +227,147 @@ protected:
 
     virtual void destroy() { /* distructor */};
 
+    /* framebuffer size changed; called before draw(), at most once per frame. render targets are already resized */
+    virtual void resize(int width, int height) { (void)width, (void)height; };
+
+    /* back to the window framebuffer and its viewport, e.g. after rendering into a render target */
+    void bindDefaultFramebuffer() {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(this->viewport[0], this->viewport[1], this->viewport[2], this->viewport[3]);
+    };
+
 public:
+    /* configure before createWindow(); swap interval changes afterwards take effect on the next window */
+    FramePacer& framePacer() {
+        return this->pacer;
+    };
+
+    const std::string& windowTitle() const {
+        return this->title;
+    };
+
+    /* call before setEnvironment() */
+    void setAntiAliasMode(AntiAliasMode mode) {
+        this->anti_aliasing.setMode(mode);
+    };
+
+    /* read back every frame from now on and hand it to sink on a separate thread; rendering slows down to the sink
+     * unless drop_frames */
+    void enableCapture(FrameCapture::Sink sink, size_t ring_size = 3, bool drop_frames = false) {
+        this->capture.reset(new FrameCapture(sink, ring_size, 16, drop_frames));
+    };
+
     virtual void mainloop() { // main loop
-        this->prepare();
-        this->initialize();
+#ifdef MYGL_TRACE
+        /* Record every gl call of this window into the file named by MYGL_TRACE_FILE; play back with Replay */
+        const char* trace_file = std::getenv("MYGL_TRACE_FILE");
+        if (trace_file) gltrace::start(trace_file);
+#endif
+        /* Timeline of this thread, the gpu and helper threads into the file named by MYGL_TIMELINE_FILE */
+        const char* timeline_file = std::getenv("MYGL_TIMELINE_FILE");
+        if (timeline_file) timeline::enable();
+        timeline::setThreadName("main");
+
+        /* Capture every frame into the sink named by MYGL_CAPTURE, e.g. raw:frames.rgba, png:frame_ or pipe:ffmpeg ...;
+         * frames are dropped rather than waited for if MYGL_CAPTURE_DROP is set */
+        const char* capture_spec = std::getenv("MYGL_CAPTURE");
+        if (capture_spec && !this->capture) {
+            this->enableCapture(capture_sinks::parse(capture_spec), 3, std::getenv("MYGL_CAPTURE_DROP") != nullptr);
+        }
 
-        while(!glfwWindowShouldClose(this->window)) {
-            /* Viewport */
-            int _width, _height;
-            glfwGetFramebufferSize(this->window, &_width, &_height);
-            // use frame buffer size instead of windows size for retina monitor adjustment
-            _width >= _height ?
-            glViewport((_width - _height) / 2, 0, _height, _height) :
-            glViewport(0, (_height - _width) / 2, _width, _width); // Aspect ratio always 1
+        this->renderLoop(true, std::cout);
 
-            /* draw */
-            this->draw();
+        if (timeline_file) timeline::writeChromeJson(timeline_file);
+#ifdef MYGL_TRACE
+        gltrace::stop();
+#endif
 
-            /* Swap buffers */
-            glfwSwapBuffers(this->window);
+        /* Destroy GLFW window */
+        this->destroyWindow();
+    };
+
+    /* frames until the window should close, then gl objects are destroyed and reports written to out. makes the
+     * context current on the calling thread and releases it at the end. polls events unless another thread pumps
+     * them, in which case this may run on any thread; see RenderThreads */
+    void renderLoop(bool poll_events, std::ostream& out) {
+        glfwMakeContextCurrent(this->window);
+        if (!poll_events) timeline::setThreadName("render " + this->title);
+
+        {
+            timeline::Zone zone("initialize");
+            this->prepare();
+            this->initialize();
+            this->anti_aliasing.initialize(this->render_targets);
+        }
 
-            /* Processing action callbacks */
-            glfwPollEvents();
+        while(!glfwWindowShouldClose(this->window)) {
+            timeline::Zone frame_zone("frame");
+
+            /* Frame limiter */
+            {
+                timeline::Zone zone("waitForFrameStart");
+                this->pacer.waitForFrameStart();
+            }
+
+            /* Processing action callbacks; polled as late as possible so that draw() sees the latest input */
+            {
+                timeline::Zone zone("pollEvents");
+                if (poll_events) glfwPollEvents();
+                this->pacer.latchInput();
+            }
+
+            /* Viewport; only touched when the framebuffer size has changed */
+            if (this->framebuffer_resized.exchange(false, std::memory_order_acquire)) {
+                timeline::Zone zone("resize");
+                this->frame_width = this->framebuffer_width.load(std::memory_order_relaxed);
+                this->frame_height = this->framebuffer_height.load(std::memory_order_relaxed);
+                this->updateViewport();
+                this->render_targets.resize(this->frame_width, this->frame_height);
+                this->resize(this->frame_width, this->frame_height);
+            }
+
+            /* draw; into an offscreen target first if anti-aliasing needs one */
+            {
+                timeline::Zone zone("draw");
+                this->gpu_timeline.begin("draw");
+                this->anti_aliasing.begin(this->render_targets, this->viewport);
+                this->occlusion.beginFrame();
+                this->draw();
+                this->occlusion.endFrame();
+                this->anti_aliasing.end(this->render_targets, this->frame_width, this->frame_height, this->viewport);
+                this->gpu_timeline.end();
+            }
+
+            /* Capture; asynchronous, from the back buffer */
+            if (this->capture) {
+                timeline::Zone zone("capture");
+                this->capture->capture(0, 0, this->frame_width, this->frame_height);
+            }
+
+            /* Swap buffers */
+            {
+                timeline::Zone zone("swapBuffers");
+                glfwSwapBuffers(this->window);
+                this->pacer.presented();
+            }
+#ifdef MYGL_TRACE
+            gltrace::frame();
+#endif
         }
 
         this->destroy();
+        this->occlusion.report(out);
+        this->occlusion.destroy();
+        this->anti_aliasing.report(out);
+        this->anti_aliasing.destroy();
+        this->render_targets.destroy();
+        if (this->capture) {
+            this->capture->finish();
+            this->capture->report(out);
+        }
+        this->gpu_timeline.destroy();
 
-        /* Destroy GLFW window */
-        glfwDestroyWindow(this->window);
+        glfwMakeContextCurrent(nullptr);
     };
 };
 
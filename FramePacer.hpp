@@ -0,0 +1,165 @@
+//
+// Created by pallas athena on 16/9/18.
+//
+
+#ifndef _FRAME_PACER_HPP
+#define _FRAME_PACER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+
+/* frame limiter & frame time metrics; knows nothing about gl, the context drives it once per frame:
+ * waitForFrameStart() -> (poll input) latchInput() -> (draw & swap) presented() */
+class FramePacer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const int ADAPTIVE_SWAP_INTERVAL = -1; // tear instead of stall on late frames, where supported
+
+private:
+    int m_swapInterval = 1;
+    double m_targetFps = 0.0; // 0 for no limiter
+    double m_refreshRate = 0.0; // of the monitor; 0 if unknown
+    Clock::duration m_spinMargin = std::chrono::microseconds(1500); // sleep granularity covered by spinning
+
+    Clock::time_point m_frameStart;
+    Clock::time_point m_inputLatched;
+    Clock::time_point m_lastPresent;
+    bool m_started = false;
+
+    /* metrics */
+    unsigned long m_frames = 0;
+    unsigned long m_missedFrames = 0;
+    Clock::duration m_totalFrameTime = Clock::duration::zero();
+    Clock::duration m_maxFrameTime = Clock::duration::zero();
+    Clock::duration m_totalLatency = Clock::duration::zero();
+    Clock::duration m_maxLatency = Clock::duration::zero();
+
+public:
+    FramePacer(){};
+
+    ~FramePacer(){};
+
+public:
+    /* 0 uncapped, 1 vsync, n every n-th refresh, ADAPTIVE_SWAP_INTERVAL adaptive vsync */
+    void setSwapInterval(int interval) {
+        this->m_swapInterval = interval;
+    };
+
+    /* cpu side limiter on top of the swap interval; 0 disables it */
+    void setTargetFps(double fps) {
+        this->m_targetFps = fps;
+    };
+
+    void setRefreshRate(double hz) {
+        this->m_refreshRate = hz;
+    };
+
+    /* neither vsync nor limiter; for throughput measurements */
+    void setBenchmarkMode() {
+        this->m_swapInterval = 0;
+        this->m_targetFps = 0.0;
+    };
+
+    int swapInterval() const {
+        return this->m_swapInterval;
+    };
+
+    /* time budget of one frame; zero if frames are not paced at all */
+    Clock::duration framePeriod() const {
+        double seconds = 0.0;
+        if (this->m_targetFps > 0.0) {
+            seconds = 1.0 / this->m_targetFps;
+        } else if (this->m_swapInterval != 0 && this->m_refreshRate > 0.0) {
+            seconds = std::abs(this->m_swapInterval) / this->m_refreshRate;
+        }
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    };
+
+public:
+    /* block until the next frame is due: coarse sleep, then spin for the remainder */
+    void waitForFrameStart() {
+        if (this->m_started && this->m_targetFps > 0.0) {
+            Clock::time_point deadline = this->m_frameStart + this->framePeriod();
+            if (deadline - this->m_spinMargin > Clock::now()) {
+                std::this_thread::sleep_until(deadline - this->m_spinMargin);
+            }
+            while (Clock::now() < deadline) std::this_thread::yield();
+
+            // a late frame starts a new schedule instead of trying to catch up
+            Clock::time_point now = Clock::now();
+            this->m_frameStart = now - deadline > this->framePeriod() ? now : deadline;
+        } else {
+            this->m_frameStart = Clock::now();
+        }
+        this->m_started = true;
+    };
+
+    /* input has just been polled; what the frame draws reflects input up to now */
+    void latchInput() {
+        this->m_inputLatched = Clock::now();
+    };
+
+    /* buffers have been swapped */
+    void presented() {
+        Clock::time_point now = Clock::now();
+
+        if (this->m_frames > 0) {
+            Clock::duration frame_time = now - this->m_lastPresent;
+            this->m_totalFrameTime += frame_time;
+            this->m_maxFrameTime = std::max(this->m_maxFrameTime, frame_time);
+
+            Clock::duration period = this->framePeriod();
+            // some slack for scheduler jitter before a frame counts as a missed deadline
+            if (period != Clock::duration::zero() && frame_time > period + period / 4) ++this->m_missedFrames;
+        }
+
+        Clock::duration latency = now - this->m_inputLatched;
+        this->m_totalLatency += latency;
+        this->m_maxLatency = std::max(this->m_maxLatency, latency);
+
+        this->m_lastPresent = now;
+        ++this->m_frames;
+    };
+
+public:
+    unsigned long frames() const {
+        return this->m_frames;
+    };
+
+    unsigned long missedFrames() const {
+        return this->m_missedFrames;
+    };
+
+    double averageFrameMs() const {
+        return this->m_frames < 2 ? 0.0 :
+               std::chrono::duration<double, std::milli>(this->m_totalFrameTime).count() / (this->m_frames - 1);
+    };
+
+    double maxFrameMs() const {
+        return std::chrono::duration<double, std::milli>(this->m_maxFrameTime).count();
+    };
+
+    /* cpu side input-to-present latency; display scan-out is not included */
+    double averageLatencyMs() const {
+        return this->m_frames == 0 ? 0.0 :
+               std::chrono::duration<double, std::milli>(this->m_totalLatency).count() / this->m_frames;
+    };
+
+    double maxLatencyMs() const {
+        return std::chrono::duration<double, std::milli>(this->m_maxLatency).count();
+    };
+
+    void report(std::ostream& out) const {
+        out << this->m_frames << " frames, " << this->m_missedFrames << " missed; frame "
+            << this->averageFrameMs() << " ms avg, " << this->maxFrameMs() << " ms max; input to present "
+            << this->averageLatencyMs() << " ms avg, " << this->maxLatencyMs() << " ms max" << std::endl;
+    };
+};
+
+
+#endif //_FRAME_PACER_HPP
@@ -0,0 +1,206 @@
+//
+// Created by pallas athena on 16/9/29.
+//
+
+#ifndef _GPU_TIMER_HPP
+#define _GPU_TIMER_HPP
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "myGL.hpp"
+#include "Timeline.hpp"
+
+
+/* gpu time of a section of commands via GL_TIME_ELAPSED queries. a ring of queries keeps several frames in flight;
+ * results are only read once available, so timing never stalls the pipeline. begin() / end() must not nest with
+ * other GL_TIME_ELAPSED queries; gl calls require the owning context to be current. */
+class GpuTimer {
+private:
+    std::vector<GLuint> m_queries;
+    std::vector<bool> m_pending;
+    size_t m_next = 0;
+
+    unsigned long m_samples = 0;
+    GLuint64 m_totalNs = 0;
+    GLuint64 m_maxNs = 0;
+
+public:
+    GpuTimer(size_t ring_size = 4) : m_queries(ring_size, 0), m_pending(ring_size, false) {};
+
+    ~GpuTimer() {
+        // gl objects can only be deleted with a current context; destroy() is the caller's duty
+        assert(this->m_queries.empty() || this->m_queries[0] == 0);
+    };
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+public:
+    void begin() {
+        if (this->m_queries[0] == 0) glGenQueries(GLsizei(this->m_queries.size()), this->m_queries.data());
+
+        // the slot to reuse is the oldest; wait for it only if the gpu is a whole ring behind
+        if (this->m_pending[this->m_next]) this->collect(this->m_next, true);
+        glBeginQuery(GL_TIME_ELAPSED, this->m_queries[this->m_next]);
+    };
+
+    void end() {
+        glEndQuery(GL_TIME_ELAPSED);
+        this->m_pending[this->m_next] = true;
+        this->m_next = (this->m_next + 1) % this->m_queries.size();
+
+        // pick up whatever else has finished meanwhile
+        for (size_t i = 0; i < this->m_queries.size(); ++i) {
+            if (this->m_pending[i]) this->collect(i, false);
+        }
+    };
+
+    void destroy() {
+        if (this->m_queries[0] != 0) glDeleteQueries(GLsizei(this->m_queries.size()), this->m_queries.data());
+        std::fill(this->m_queries.begin(), this->m_queries.end(), 0);
+        std::fill(this->m_pending.begin(), this->m_pending.end(), false);
+    };
+
+public:
+    unsigned long samples() const {
+        return this->m_samples;
+    };
+
+    double averageMs() const {
+        return this->m_samples == 0 ? 0.0 : this->m_totalNs / 1e6 / this->m_samples;
+    };
+
+    double maxMs() const {
+        return this->m_maxNs / 1e6;
+    };
+
+private:
+    void collect(size_t slot, bool wait) {
+        if (!wait) {
+            GLint available = 0;
+            glGetQueryObjectiv(this->m_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(this->m_queries[slot], GL_QUERY_RESULT, &elapsed);
+        this->m_pending[slot] = false;
+
+        ++this->m_samples;
+        this->m_totalNs += elapsed;
+        this->m_maxNs = std::max(this->m_maxNs, elapsed);
+    };
+};
+
+
+/* gpu zones on the timeline: GL_TIMESTAMP queries around a section of commands, read back once available and moved
+ * onto the cpu clock with an offset measured by glGetInteger64v(GL_TIMESTAMP), so gpu work lines up with the cpu
+ * zones that submitted it. the offset is re-measured every recalibration_interval zones against clock drift. does
+ * nothing while the timeline is disabled; gl calls require the owning context to be current. */
+class GpuTimeline {
+private:
+    struct Pending {
+        const char* name;
+        GLuint begin;
+        GLuint end;
+    };
+
+    std::vector<GLuint> m_free; // unused query objects
+    std::vector<GLuint> m_all;
+    std::deque<Pending> m_pending; // in submission order
+    const char* m_open = nullptr; // name of the zone between begin() and end()
+    GLuint m_openQuery = 0;
+
+    timeline::Track* m_track = nullptr;
+    int64_t m_offset = 0; // cpu ns - gpu ns
+    unsigned long m_zones = 0;
+    unsigned long m_recalibrationInterval;
+
+public:
+    GpuTimeline(unsigned long recalibration_interval = 600) : m_recalibrationInterval(recalibration_interval) {};
+
+    ~GpuTimeline() {
+        // gl objects can only be deleted with a current context; destroy() is the caller's duty
+        assert(this->m_all.empty());
+    };
+
+    GpuTimeline(const GpuTimeline&) = delete;
+    GpuTimeline& operator=(const GpuTimeline&) = delete;
+
+public:
+    /* name must be a string literal; zones do not nest */
+    void begin(const char* name) {
+        if (!timeline::enabled()) return;
+        assert(!this->m_open);
+        if (!this->m_track) this->m_track = &timeline::Registry::instance().create("gpu");
+        if (this->m_zones++ % this->m_recalibrationInterval == 0) this->calibrate();
+
+        this->m_open = name;
+        this->m_openQuery = this->query();
+        glQueryCounter(this->m_openQuery, GL_TIMESTAMP);
+    };
+
+    void end() {
+        if (!this->m_open) return;
+        GLuint query = this->query();
+        glQueryCounter(query, GL_TIMESTAMP);
+        this->m_pending.push_back(Pending{this->m_open, this->m_openQuery, query});
+        this->m_open = nullptr;
+
+        this->collect(false);
+    };
+
+    /* wait for every zone in flight and delete gl objects */
+    void destroy() {
+        this->collect(true);
+        if (!this->m_all.empty()) glDeleteQueries(GLsizei(this->m_all.size()), this->m_all.data());
+        this->m_all.clear();
+        this->m_free.clear();
+    };
+
+private:
+    GLuint query() {
+        if (this->m_free.empty()) {
+            GLuint queries[8];
+            glGenQueries(8, queries);
+            this->m_free.insert(this->m_free.end(), queries, queries + 8);
+            this->m_all.insert(this->m_all.end(), queries, queries + 8);
+        }
+        GLuint query = this->m_free.back();
+        this->m_free.pop_back();
+        return query;
+    };
+
+    void calibrate() {
+        GLint64 gpu = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpu);
+        this->m_offset = int64_t(timeline::now()) - int64_t(gpu);
+    };
+
+    /* record finished zones in order; stop at the first one still in flight unless waiting */
+    void collect(bool wait) {
+        while (!this->m_pending.empty()) {
+            const Pending& zone = this->m_pending.front();
+            if (!wait) {
+                GLint available = 0;
+                glGetQueryObjectiv(zone.end, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) return;
+            }
+
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(zone.begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(zone.end, GL_QUERY_RESULT, &end);
+            this->m_track->append(zone.name, nullptr, uint64_t(int64_t(begin) + this->m_offset),
+                                  uint64_t(int64_t(end) + this->m_offset));
+
+            this->m_free.push_back(zone.begin);
+            this->m_free.push_back(zone.end);
+            this->m_pending.pop_front();
+        }
+    };
+};
+
+
+#endif //_GPU_TIMER_HPP
@@ -1,12 +1,12 @@
-#ifndef _GEOMETRY_HPP
-#define _GEOMETRY_HPP
+#ifndef _HELLO_GL_GEOMETRY_HPP
+#define _HELLO_GL_GEOMETRY_HPP
 
 #include <vector>
 #include <complex>
 #include <cmath>
 
 /* return the vertices of a regular polygon */
-std::vector<float> regularPolygon(float radius, int angles) {
+inline std::vector<float> regularPolygon(float radius, int angles) {
     std::vector<float> vertices;
     std::complex<float> unit_root(
             std::cos(2.0f * float(M_PI) / angles),
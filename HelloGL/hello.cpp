@@ -1,5 +1,6 @@
 #include "../myGL.hpp"
 #include "Geometry.hpp"
+#include "../VertexPulling.hpp"
 #include <GLFW/glfw3.h>
 
 
@@ -12,6 +13,7 @@ static const std::vector<GLfloat> vertex_position_data = regularPolygon(0.8f, 3)
 
 const std::string vertex_shader_file = "plane.vert";
 const std::string fragment_shader_file = "solid_color.frag";
+const std::string pulling_vertex_shader_file = "polygon.vert";
 
 
 /* Handle potential glfw errors. */
@@ -24,6 +26,10 @@ static void window_size_callback(GLFWwindow* window, int w, int h);
 
 int main(int argc, char* argv[])
 {
+    /* usage: HelloGL [vbo|pulling]; pulling derives the triangle in the vertex shader without any vertex buffer */
+    const bool pulling = argc > 1 && std::string(argv[1]) == "pulling";
+    PolygonPulling polygons;
+
     GLFWwindow* window;
 
     glfwSetErrorCallback(error_callback);
@@ -79,7 +85,8 @@ int main(int argc, char* argv[])
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
     /* create VBO object */
-    GLuint vertex_buffer; {
+    GLuint vertex_buffer = 0;
+    if (!pulling) {
         glGenBuffers(1, &vertex_buffer);
         glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
 
@@ -93,7 +100,8 @@ int main(int argc, char* argv[])
     }
 
     /* create VAO object */
-    GLuint vertex_array; {
+    GLuint vertex_array = 0;
+    if (!pulling) {
         glGenVertexArrays(1, &vertex_array);
         glBindVertexArray(vertex_array);
 
@@ -110,7 +118,9 @@ int main(int argc, char* argv[])
 
 
     /* create and compile shaders */
-    GLuint program_id = compileShaders(vertex_shader_file, fragment_shader_file);
+    GLuint program_id = compileShaders(pulling ? pulling_vertex_shader_file : vertex_shader_file,
+                                       fragment_shader_file);
+    if (pulling) polygons.initialize(program_id);
 
     /* Apply the shader */
     glUseProgram(program_id);
@@ -132,11 +142,15 @@ int main(int argc, char* argv[])
 
 
         /* Render work */
-        glDrawArrays(
-                GL_TRIANGLES, // surfel type
-                0, // starting index
-                3 // indices to be rendered
-        );
+        if (pulling) {
+            polygons.draw(0.8f, 3);
+        } else {
+            glDrawArrays(
+                    GL_TRIANGLES, // surfel type
+                    0, // starting index
+                    3 // indices to be rendered
+            );
+        }
 
         /* Swap buffers */
         glfwSwapBuffers(window);
@@ -151,6 +165,7 @@ int main(int argc, char* argv[])
     glDeleteBuffers(1, &vertex_buffer);
     glDeleteVertexArrays(1, &vertex_array);
     glDeleteProgram(program_id);
+    polygons.destroy();
 
 
     /* Destroy GLFW window */
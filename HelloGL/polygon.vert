@@ -0,0 +1,22 @@
+#version 330 core
+
+// No input vertex data; vertices are pulled from gl_VertexID & gl_InstanceID, see VertexPulling.hpp
+uniform float radius; // of the circumscribed circle; relative to half a cell when drawing a grid
+uniform int angles;
+uniform int gridSide; // 0: one polygon at the origin; otherwise gridSide x gridSide cells, one per instance
+uniform float cellSize;
+
+void main(){
+
+    // corner i lies at the i-th root of unity, as in regularPolygon()
+    float angle = 6.28318530718 * float(gl_VertexID) / float(angles);
+    vec2 position = radius * vec2(cos(angle), sin(angle));
+
+    if (gridSide > 0) {
+        vec2 cell = vec2(gl_InstanceID % gridSide, gl_InstanceID / gridSide);
+        position = -1.0 + (cell + 0.5 + 0.5 * position) * cellSize;
+    }
+
+    gl_Position.xyz = vec3(position, 0.0);
+    gl_Position.w = 1.0;
+}
@@ -0,0 +1,164 @@
+//
+// Created by pallas athena on 16/9/16.
+//
+
+#ifndef _INDIRECT_DRAW_HPP
+#define _INDIRECT_DRAW_HPP
+
+#include <vector>
+
+#include "myGL.hpp"
+
+
+/* command layouts consumed from GL_DRAW_INDIRECT_BUFFER; field order fixed by the specification */
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance; // must be 0 before GL 4.2
+};
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance; // must be 0 before GL 4.2
+};
+
+
+/* how indirect commands can be submitted by the current context */
+enum class IndirectSupport {
+    None,   // 3.3: commands are replayed from the cpu copy, one instanced draw each
+    Single, // 4.0 - 4.2: one glDraw*Indirect per command read from the buffer
+    Multi   // 4.3+: one glMultiDraw*Indirect for all commands
+};
+
+/* query the version of the current context */
+inline IndirectSupport queryIndirectSupport() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+#ifdef GL_VERSION_4_3
+    if (major > 4 || (major == 4 && minor >= 3)) return IndirectSupport::Multi;
+#endif
+#ifdef GL_VERSION_4_0
+    if (major >= 4) return IndirectSupport::Single;
+#endif
+    return IndirectSupport::None;
+};
+
+
+/* cpu staging of indirect commands plus the GL_DRAW_INDIRECT_BUFFER they are uploaded to. Command is one of the two
+ * structs above; gl calls require the owning context to be current. */
+template <typename Command> class IndirectDrawBuffer {
+public:
+    std::vector<Command> commands; // filled by the caller each frame, or once for static scenes
+
+private:
+    IndirectSupport m_support;
+    GLuint m_buffer = 0;
+    GLsizeiptr m_capacity = 0;
+
+public:
+    IndirectDrawBuffer(IndirectSupport support) : m_support(support) {};
+
+    ~IndirectDrawBuffer() {
+        // gl objects can only be deleted with a current context; destroy() is the caller's duty
+        assert(this->m_buffer == 0);
+    };
+
+    IndirectDrawBuffer(const IndirectDrawBuffer&) = delete;
+    IndirectDrawBuffer& operator=(const IndirectDrawBuffer&) = delete;
+
+public:
+    /* copy commands to the gpu; storage is orphaned so that frames in flight keep their own copy */
+    void upload() {
+        if (this->m_support == IndirectSupport::None) return;
+
+        GLsizeiptr size = GLsizeiptr(sizeof(Command) * this->commands.size());
+        if (this->m_buffer == 0) glGenBuffers(1, &this->m_buffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->m_buffer);
+        if (size > this->m_capacity) this->m_capacity = size;
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, this->m_capacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, this->commands.data());
+    };
+
+    /* submit all commands; the VAO holding the referenced vertex (and index) data must be bound */
+    void submit(GLenum mode) const {
+        this->submitCommands(mode, static_cast<const Command*>(nullptr));
+    };
+
+    void destroy() {
+        if (this->m_buffer != 0) glDeleteBuffers(1, &this->m_buffer);
+        this->m_buffer = 0;
+        this->m_capacity = 0;
+    };
+
+public:
+    IndirectSupport support() const {
+        return this->m_support;
+    };
+
+private:
+    /* overloads selected by command type */
+    void submitCommands(GLenum mode, const DrawArraysIndirectCommand*) const {
+        const GLsizei count = GLsizei(this->commands.size());
+        switch (this->m_support) {
+#ifdef GL_VERSION_4_3
+            case IndirectSupport::Multi:
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->m_buffer);
+                glMultiDrawArraysIndirect(mode, (void*)0, count, 0);
+                break;
+#endif
+#ifdef GL_VERSION_4_0
+            case IndirectSupport::Single:
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->m_buffer);
+                for (GLsizei i = 0; i < count; ++i) {
+                    glDrawArraysIndirect(mode, (void*)(sizeof(DrawArraysIndirectCommand) * i));
+                }
+                break;
+#endif
+            default:
+                for (const DrawArraysIndirectCommand& command : this->commands) {
+                    glDrawArraysInstanced(mode, GLint(command.first), GLsizei(command.count),
+                                          GLsizei(command.instanceCount));
+                }
+                break;
+        }
+    };
+
+    void submitCommands(GLenum mode, const DrawElementsIndirectCommand*) const {
+        const GLsizei count = GLsizei(this->commands.size());
+        switch (this->m_support) {
+#ifdef GL_VERSION_4_3
+            case IndirectSupport::Multi:
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->m_buffer);
+                glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (void*)0, count, 0);
+                break;
+#endif
+#ifdef GL_VERSION_4_0
+            case IndirectSupport::Single:
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->m_buffer);
+                for (GLsizei i = 0; i < count; ++i) {
+                    glDrawElementsIndirect(mode, GL_UNSIGNED_INT,
+                                           (void*)(sizeof(DrawElementsIndirectCommand) * i));
+                }
+                break;
+#endif
+            default:
+                for (const DrawElementsIndirectCommand& command : this->commands) {
+                    glDrawElementsInstancedBaseVertex(
+                            mode, GLsizei(command.count), GL_UNSIGNED_INT,
+                            (void*)(sizeof(GLuint) * command.firstIndex),
+                            GLsizei(command.instanceCount), command.baseVertex
+                    );
+                }
+                break;
+        }
+    };
+};
+
+
+#endif //_INDIRECT_DRAW_HPP
@@ -0,0 +1,402 @@
+//
+// Created by pallas athena on 16/9/14.
+//
+
+#ifndef _MESH_BUFFER_HPP
+#define _MESH_BUFFER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "myGL.hpp"
+
+
+/* buddy allocator over an abstract range of [0, capacity) units; capacity is rounded up to a power of two of at most
+ * MAX_CAPACITY */
+class BuddyAllocator {
+public:
+    static const GLuint INVALID_OFFSET = 0xFFFFFFFFu;
+    static const GLuint MAX_CAPACITY = 1u << 31;
+
+private:
+    GLuint m_maxOrder; // capacity == 1 << m_maxOrder
+    std::vector<std::set<GLuint>> m_freeBlocks; // free block offsets per order
+    std::map<GLuint, GLuint> m_allocatedOrders; // offset -> order of allocated blocks
+
+    GLuint m_usedUnits = 0;
+    GLuint m_requestedUnits = 0; // before rounding to powers of two; for internal fragmentation
+
+    static GLuint orderOf(GLuint units) {
+        GLuint order = 0;
+        while ((1u << order) < units) ++order;
+        return order;
+    };
+
+public:
+    BuddyAllocator(GLuint capacity) : m_maxOrder(orderOf(capacity < MAX_CAPACITY ? capacity : MAX_CAPACITY)),
+                                      m_freeBlocks(m_maxOrder + 1) {
+        this->m_freeBlocks[this->m_maxOrder].insert(0);
+    };
+
+    ~BuddyAllocator(){};
+
+public:
+    /* offset of a block holding at least units; INVALID_OFFSET if no block is large enough */
+    GLuint allocate(GLuint units) {
+        if (units == 0) units = 1;
+        if (units > this->capacity()) return INVALID_OFFSET;
+        GLuint order = orderOf(units);
+        if (order > this->m_maxOrder) return INVALID_OFFSET;
+
+        // smallest free block that fits
+        GLuint found = order;
+        while (found <= this->m_maxOrder && this->m_freeBlocks[found].empty()) ++found;
+        if (found > this->m_maxOrder) return INVALID_OFFSET;
+
+        GLuint offset = *this->m_freeBlocks[found].begin();
+        this->m_freeBlocks[found].erase(this->m_freeBlocks[found].begin());
+
+        // split down; the upper halves become free buddies
+        while (found > order) {
+            --found;
+            this->m_freeBlocks[found].insert(offset + (1u << found));
+        }
+
+        this->m_allocatedOrders[offset] = order;
+        this->m_usedUnits += 1u << order;
+        this->m_requestedUnits += units;
+        return offset;
+    };
+
+    /* units is the amount passed to allocate(); only used for statistics */
+    void free(GLuint offset, GLuint units) {
+        auto allocated = this->m_allocatedOrders.find(offset);
+        assert(allocated != this->m_allocatedOrders.end());
+
+        GLuint order = allocated->second;
+        this->m_allocatedOrders.erase(allocated);
+        this->m_usedUnits -= 1u << order;
+        this->m_requestedUnits -= units == 0 ? 1 : units;
+
+        // merge with free buddies as far as possible
+        while (order < this->m_maxOrder) {
+            GLuint buddy = offset ^ (1u << order);
+            auto it = this->m_freeBlocks[order].find(buddy);
+            if (it == this->m_freeBlocks[order].end()) break;
+            this->m_freeBlocks[order].erase(it);
+            offset = std::min(offset, buddy);
+            ++order;
+        }
+        this->m_freeBlocks[order].insert(offset);
+    };
+
+public:
+    GLuint capacity() const {
+        return 1u << this->m_maxOrder;
+    };
+
+    GLuint usedUnits() const {
+        return this->m_usedUnits;
+    };
+
+    GLuint requestedUnits() const {
+        return this->m_requestedUnits;
+    };
+
+    GLuint largestFreeBlock() const {
+        for (GLuint order = this->m_maxOrder + 1; order-- > 0;) {
+            if (!this->m_freeBlocks[order].empty()) return 1u << order;
+        }
+        return 0;
+    };
+
+    /* 0 when all free space is one block, towards 1 as free space splinters */
+    float externalFragmentation() const {
+        GLuint free_units = this->capacity() - this->m_usedUnits;
+        return free_units == 0 ? 0.0f : 1.0f - float(this->largestFreeBlock()) / float(free_units);
+    };
+
+    /* share of used space wasted by power-of-two rounding */
+    float internalFragmentation() const {
+        return this->m_usedUnits == 0 ? 0.0f : 1.0f - float(this->m_requestedUnits) / float(this->m_usedUnits);
+    };
+};
+
+
+/* interleaved vertex layout shared by every mesh in a MeshBuffer; same "PNTC" pattern as VertexBufferHeader */
+struct VertexFormat {
+    GLint positionVecDimension;
+    GLint normalVecDimension;
+    GLint uvVecDimension;
+    GLint colorVecDimension;
+    GLenum dataType;
+    GLsizei componentSize;
+
+    GLsizei stride() const {
+        return componentSize * (positionVecDimension + normalVecDimension + uvVecDimension + colorVecDimension);
+    };
+
+    bool operator==(const VertexFormat& other) const {
+        return positionVecDimension == other.positionVecDimension &&
+               normalVecDimension == other.normalVecDimension &&
+               uvVecDimension == other.uvVecDimension &&
+               colorVecDimension == other.colorVecDimension &&
+               dataType == other.dataType;
+    };
+
+    template <typename T> static VertexFormat of(const VertexBufferHeader<T>& header) {
+        return VertexFormat{
+                header.positionVecDimension(), header.normalVecDimension(),
+                header.uvVecDimension(), header.colorVecDimension(),
+                header.dataType(), GLsizei(sizeof(T))
+        };
+    };
+};
+
+
+/* handle of a mesh living in a MeshBuffer; baseVertex and firstIndex are relative to its page */
+struct MeshHandle {
+    GLuint page;
+    GLint baseVertex;
+    GLuint verticesCount;
+    GLuint firstIndex;
+    GLuint indicesCount;
+
+    /* byte offset of the first index, as glDrawElements* expects it */
+    const void* indexDataOffset() const {
+        return (void*)(sizeof(GLuint) * this->firstIndex);
+    };
+};
+
+
+/* a few large VBO / IBO pairs carved up by buddy allocators; meshes of the same vertex format share one VAO per
+ * page and are drawn with glDrawElementsBaseVertex. vertex attributes get consecutive locations in PNTC order,
+ * skipping absent ones. gl calls require the owning context to be current. */
+class MeshBuffer {
+private:
+    struct Page {
+        GLuint vertex_array;
+        GLuint vertex_buffer;
+        GLuint index_buffer;
+        BuddyAllocator vertices; // in vertices
+        BuddyAllocator indices;  // in GLuint indices
+
+        Page(GLuint vertices_capacity, GLuint indices_capacity) :
+                vertex_array(0), vertex_buffer(0), index_buffer(0),
+                vertices(vertices_capacity), indices(indices_capacity) {};
+    };
+
+    VertexFormat m_format;
+    GLuint m_pageVertices;
+    GLuint m_pageIndices;
+    std::vector<Page> m_pages;
+
+    /* per page multi-draw scratch arrays */
+    std::vector<std::vector<GLsizei>> m_drawCounts;
+    std::vector<std::vector<const void*>> m_drawOffsets;
+    std::vector<std::vector<GLint>> m_drawBaseVertices;
+
+public:
+    MeshBuffer(const VertexFormat& format, GLuint page_vertices = 1u << 20, GLuint page_indices = 1u << 22) :
+            m_format(format), m_pageVertices(page_vertices), m_pageIndices(page_indices) {};
+
+    ~MeshBuffer() {
+        // gl objects can only be deleted with a current context; destroy() is the caller's duty
+        assert(this->m_pages.empty());
+    };
+
+    MeshBuffer(const MeshBuffer&) = delete;
+    MeshBuffer& operator=(const MeshBuffer&) = delete;
+
+private:
+    /* may run inside allocate(); the caller's vertex array & array buffer bindings are put back at the end, the
+     * element array buffer binding is vertex array state */
+    void addPage(GLuint vertices_capacity, GLuint indices_capacity) {
+        this->m_pages.emplace_back(vertices_capacity, indices_capacity);
+        this->m_drawCounts.emplace_back();
+        this->m_drawOffsets.emplace_back();
+        this->m_drawBaseVertices.emplace_back();
+        Page& page = this->m_pages.back();
+
+        GLint vertex_array, array_buffer;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertex_array);
+        glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &array_buffer);
+
+        glGenVertexArrays(1, &page.vertex_array);
+        glBindVertexArray(page.vertex_array);
+
+        glGenBuffers(1, &page.vertex_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, page.vertex_buffer);
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(page.vertices.capacity()) * this->m_format.stride(), nullptr,
+                     GL_STATIC_DRAW);
+
+        glGenBuffers(1, &page.index_buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.index_buffer); // recorded in the VAO
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(page.indices.capacity()) * sizeof(GLuint), nullptr,
+                     GL_STATIC_DRAW);
+
+        const GLint dimensions[] = {
+                this->m_format.positionVecDimension, this->m_format.normalVecDimension,
+                this->m_format.uvVecDimension, this->m_format.colorVecDimension
+        };
+        GLuint location = 0;
+        GLsizei offset = 0;
+        for (GLint dimension : dimensions) {
+            if (dimension == 0) continue;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(
+                    location, // counterpart of layout in the shader
+                    dimension, // components per vertex
+                    this->m_format.dataType, // data type
+                    GL_FALSE, // whether normalized
+                    this->m_format.stride(), // stride
+                    (void*)(GLintptr)offset // offset
+            );
+            ++location;
+            offset += dimension * this->m_format.componentSize;
+        }
+
+        glBindVertexArray(GLuint(vertex_array));
+        glBindBuffer(GL_ARRAY_BUFFER, GLuint(array_buffer));
+    };
+
+public:
+    /* copy interleaved vertex data and indices (relative to the mesh's first vertex) into a shared page; a mesh
+     * larger than a page gets a page of its own size */
+    template <typename T> MeshHandle allocate(const VertexBufferHeader<T>& header, const std::vector<GLuint>& indices) {
+        assert(VertexFormat::of(header) == this->m_format);
+        if (uint64_t(header.verticesCount()) > BuddyAllocator::MAX_CAPACITY ||
+            uint64_t(indices.size()) > BuddyAllocator::MAX_CAPACITY) {
+            std::cerr << "Unable to allocate mesh of " << header.verticesCount() << " vertices, " << indices.size()
+                      << " indices: larger than a page can be" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        MeshHandle handle;
+        handle.verticesCount = GLuint(header.verticesCount());
+        handle.indicesCount = GLuint(indices.size());
+
+        // first fit over the pages, opening a new one when none has room
+        GLuint vertex_offset = BuddyAllocator::INVALID_OFFSET, index_offset = BuddyAllocator::INVALID_OFFSET;
+        for (handle.page = 0; handle.page < this->m_pages.size(); ++handle.page) {
+            Page& page = this->m_pages[handle.page];
+            vertex_offset = page.vertices.allocate(handle.verticesCount);
+            if (vertex_offset == BuddyAllocator::INVALID_OFFSET) continue;
+            index_offset = page.indices.allocate(handle.indicesCount);
+            if (index_offset != BuddyAllocator::INVALID_OFFSET) break;
+            page.vertices.free(vertex_offset, handle.verticesCount);
+        }
+        if (handle.page == this->m_pages.size()) {
+            this->addPage(std::max(this->m_pageVertices, handle.verticesCount),
+                          std::max(this->m_pageIndices, handle.indicesCount));
+            vertex_offset = this->m_pages.back().vertices.allocate(handle.verticesCount);
+            index_offset = this->m_pages.back().indices.allocate(handle.indicesCount);
+        }
+        handle.baseVertex = GLint(vertex_offset);
+        handle.firstIndex = index_offset;
+
+        // upload through the copy target so that the caller's array buffer binding is not disturbed
+        const Page& page = this->m_pages[handle.page];
+        GLint copy_buffer;
+        glGetIntegerv(GL_COPY_WRITE_BUFFER_BINDING, &copy_buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.vertex_buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(vertex_offset) * this->m_format.stride(),
+                        GLsizeiptr(handle.verticesCount) * this->m_format.stride(), header.bufferData());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.index_buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(index_offset) * sizeof(GLuint),
+                        GLsizeiptr(handle.indicesCount) * sizeof(GLuint), indices.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, GLuint(copy_buffer));
+
+        return handle;
+    };
+
+    void free(const MeshHandle& handle) {
+        Page& page = this->m_pages[handle.page];
+        page.vertices.free(GLuint(handle.baseVertex), handle.verticesCount);
+        page.indices.free(handle.firstIndex, handle.indicesCount);
+    };
+
+    /* delete every page; all handles become invalid */
+    void destroy() {
+        for (Page& page : this->m_pages) {
+            glDeleteVertexArrays(1, &page.vertex_array);
+            glDeleteBuffers(1, &page.vertex_buffer);
+            glDeleteBuffers(1, &page.index_buffer);
+        }
+        this->m_pages.clear();
+        this->m_drawCounts.clear();
+        this->m_drawOffsets.clear();
+        this->m_drawBaseVertices.clear();
+    };
+
+public:
+    /* bind the VAO of a page; only needed once for any number of meshes in it */
+    void bind(GLuint page) const {
+        glBindVertexArray(this->m_pages[page].vertex_array);
+    };
+
+    /* draw a single mesh; its page must be bound */
+    void draw(const MeshHandle& handle, GLenum mode = GL_TRIANGLES) const {
+        glDrawElementsBaseVertex(mode, GLsizei(handle.indicesCount), GL_UNSIGNED_INT, handle.indexDataOffset(),
+                                 handle.baseVertex);
+    };
+
+    /* draw many meshes with one VAO bind and one multi-draw call per page */
+    void drawAll(const std::vector<MeshHandle>& handles, GLenum mode = GL_TRIANGLES) {
+        for (size_t i = 0; i < this->m_pages.size(); ++i) {
+            this->m_drawCounts[i].clear();
+            this->m_drawOffsets[i].clear();
+            this->m_drawBaseVertices[i].clear();
+        }
+        for (const MeshHandle& handle : handles) {
+            this->m_drawCounts[handle.page].push_back(GLsizei(handle.indicesCount));
+            this->m_drawOffsets[handle.page].push_back(handle.indexDataOffset());
+            this->m_drawBaseVertices[handle.page].push_back(handle.baseVertex);
+        }
+        for (GLuint i = 0; i < this->m_pages.size(); ++i) {
+            if (this->m_drawCounts[i].empty()) continue;
+            this->bind(i);
+            glMultiDrawElementsBaseVertex(
+                    mode, this->m_drawCounts[i].data(), GL_UNSIGNED_INT,
+                    const_cast<const void* const*>(this->m_drawOffsets[i].data()),
+                    GLsizei(this->m_drawCounts[i].size()), this->m_drawBaseVertices[i].data()
+            );
+        }
+    };
+
+public:
+    const VertexFormat& format() const {
+        return this->m_format;
+    };
+
+    GLuint pagesCount() const {
+        return GLuint(this->m_pages.size());
+    };
+
+    /* worst external fragmentation of vertex storage over all pages */
+    float vertexFragmentation() const {
+        float fragmentation = 0.0f;
+        for (const Page& page : this->m_pages) {
+            fragmentation = std::max(fragmentation, page.vertices.externalFragmentation());
+        }
+        return fragmentation;
+    };
+
+    void report(std::ostream& out) const {
+        for (size_t i = 0; i < this->m_pages.size(); ++i) {
+            const Page& page = this->m_pages[i];
+            out << "page " << i << ": vertices " << page.vertices.usedUnits() << "/" << page.vertices.capacity()
+                << " (external " << page.vertices.externalFragmentation()
+                << ", internal " << page.vertices.internalFragmentation() << "), indices "
+                << page.indices.usedUnits() << "/" << page.indices.capacity()
+                << " (external " << page.indices.externalFragmentation()
+                << ", internal " << page.indices.internalFragmentation() << ")" << std::endl;
+        }
+    };
+};
+
+
+#endif //_MESH_BUFFER_HPP
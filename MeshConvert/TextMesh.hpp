@@ -0,0 +1,464 @@
+//
+// Created by pallas athena on 16/10/8.
+//
+
+#ifndef _TEXT_MESH_HPP
+#define _TEXT_MESH_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../myGL.hpp"
+#include "../MeshFile.hpp"
+
+
+/* a mesh parsed from a text format, interleaved "PNTC" like VertexBufferHeader<GLfloat> */
+struct TextMesh {
+    std::vector<GLfloat> vertices;
+    GLsizei verticesCount = 0;
+    GLint positionVecDimension = 3;
+    GLint normalVecDimension = 0;
+    GLint uvVecDimension = 0;
+    GLint colorVecDimension = 0;
+    std::vector<GLuint> indices;
+    std::vector<MeshSubmesh> submeshes;
+
+    VertexBufferHeader<GLfloat> header() const {
+        return VertexBufferHeader<GLfloat>(this->vertices, this->verticesCount, this->positionVecDimension,
+                                           this->normalVecDimension, this->uvVecDimension, this->colorVecDimension);
+    };
+
+    GLint stride() const {
+        return this->positionVecDimension + this->normalVecDimension + this->uvVecDimension + this->colorVecDimension;
+    };
+};
+
+
+/* whole file into memory */
+inline std::string readTextFile(const std::string& file) {
+    FILE* in = std::fopen(file.c_str(), "rb");
+    if (!in) {
+        std::cerr << "Unable to read mesh file: " + file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::string text;
+    std::fseek(in, 0, SEEK_END);
+    text.resize(size_t(std::ftell(in)));
+    std::fseek(in, 0, SEEK_SET);
+    if (!text.empty() && std::fread(&text[0], 1, text.size(), in) != text.size()) text.clear();
+    std::fclose(in);
+    return text;
+};
+
+
+/* Wavefront OBJ: v (optionally followed by r g b), vt, vn and polygonal f, triangulated as fans. each distinct
+ * v/vt/vn combination becomes one vertex; o, g and usemtl start a new submesh */
+inline TextMesh readObjMesh(const std::string& file) {
+    timeline::Zone zone("readObjMesh", file);
+    const std::string text = readTextFile(file);
+
+    std::vector<GLfloat> positions, colors, uvs, normals;
+    struct Corner { long v, t, n; };
+    struct CornerHash {
+        size_t operator()(const Corner& c) const {
+            return std::hash<long>()(c.v) ^ (std::hash<long>()(c.t) << 1) ^ (std::hash<long>()(c.n) << 2);
+        };
+    };
+    struct CornerEqual {
+        bool operator()(const Corner& a, const Corner& b) const {
+            return a.v == b.v && a.t == b.t && a.n == b.n;
+        };
+    };
+    std::unordered_map<Corner, GLuint, CornerHash, CornerEqual> unified;
+    std::vector<Corner> corners; // of each unified vertex
+
+    TextMesh mesh;
+    uint32_t submesh_begin = 0;
+    auto closeSubmesh = [&mesh, &submesh_begin]() {
+        uint32_t end = uint32_t(mesh.indices.size());
+        if (end > submesh_begin) mesh.submeshes.push_back(MeshSubmesh{submesh_begin, end - submesh_begin, 0, 0});
+        submesh_begin = end;
+    };
+
+    const char* p = text.c_str();
+    const char* const end = p + text.size();
+    std::vector<GLuint> face;
+    while (p < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+        if (!line_end) line_end = end;
+        while (p < line_end && (*p == ' ' || *p == '\t')) ++p;
+
+        if (p[0] == 'v' && p[1] == ' ') {
+            char* next;
+            float values[6] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+            int count = 0;
+            for (p += 2; count < 6; ++count) {
+                float value = std::strtof(p, &next);
+                if (next == p || next > line_end) break;
+                values[count] = value;
+                p = next;
+            }
+            positions.insert(positions.end(), values, values + 3);
+            if (count == 6 || !colors.empty()) {
+                colors.resize(positions.size() - 3, 1.0f); // vertices before the first colored one are white
+                colors.insert(colors.end(), values + 3, values + 6);
+            }
+        } else if (p[0] == 'v' && p[1] == 't') {
+            char* next;
+            float u = std::strtof(p + 2, &next);
+            float v = std::strtof(next, &next);
+            uvs.push_back(u), uvs.push_back(v);
+        } else if (p[0] == 'v' && p[1] == 'n') {
+            char* next;
+            float x = std::strtof(p + 2, &next);
+            float y = std::strtof(next, &next);
+            float z = std::strtof(next, &next);
+            normals.push_back(x), normals.push_back(y), normals.push_back(z);
+        } else if (p[0] == 'f' && p[1] == ' ') {
+            face.clear();
+            p += 2;
+            while (p < line_end) {
+                char* next;
+                long index[3] = {0, 0, 0}; // v, vt, vn; 0 when absent
+                index[0] = std::strtol(p, &next, 10);
+                if (next == p) break;
+                p = next;
+                for (int k = 1; k < 3 && *p == '/'; ++k) {
+                    ++p;
+                    index[k] = std::strtol(p, &next, 10);
+                    p = next;
+                }
+                // negative indices count back from the latest element
+                const long counts[3] = {long(positions.size() / 3), long(uvs.size() / 2), long(normals.size() / 3)};
+                for (int k = 0; k < 3; ++k) {
+                    if (index[k] < 0) index[k] += counts[k] + 1;
+                }
+
+                Corner corner = {index[0], index[1], index[2]};
+                auto found = unified.find(corner);
+                if (found == unified.end()) {
+                    found = unified.emplace(corner, GLuint(corners.size())).first;
+                    corners.push_back(corner);
+                }
+                face.push_back(found->second);
+                while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+            }
+            for (size_t i = 2; i < face.size(); ++i) {
+                mesh.indices.push_back(face[0]), mesh.indices.push_back(face[i - 1]), mesh.indices.push_back(face[i]);
+            }
+        } else if ((p[0] == 'o' || p[0] == 'g') && p[1] == ' ') {
+            closeSubmesh();
+        } else if (std::strncmp(p, "usemtl", 6) == 0) {
+            closeSubmesh();
+        }
+
+        p = line_end + 1;
+    }
+    closeSubmesh();
+    if (!colors.empty()) colors.resize(positions.size(), 1.0f);
+
+    // every corner must refer to an existing element; 0 only where vt / vn are absent
+    const long counts[3] = {long(positions.size() / 3), long(uvs.size() / 2), long(normals.size() / 3)};
+    for (const Corner& corner : corners) {
+        if (corner.v < 1 || corner.v > counts[0] || corner.t < 0 || corner.t > counts[1] ||
+            corner.n < 0 || corner.n > counts[2]) {
+            std::cerr << "Unable to read obj file " + file + ": face index out of range" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // interleave
+    bool has_uv = false, has_normal = false;
+    for (const Corner& corner : corners) has_uv |= corner.t != 0, has_normal |= corner.n != 0;
+    mesh.normalVecDimension = has_normal ? 3 : 0;
+    mesh.uvVecDimension = has_uv ? 2 : 0;
+    mesh.colorVecDimension = colors.empty() ? 0 : 3;
+    mesh.verticesCount = GLsizei(corners.size());
+    mesh.vertices.reserve(size_t(mesh.stride()) * corners.size());
+
+    auto append = [&mesh](const std::vector<GLfloat>& source, long index, int dimension) {
+        size_t at = size_t(index - 1) * dimension;
+        if (index == 0) mesh.vertices.insert(mesh.vertices.end(), dimension, 0.0f);
+        else mesh.vertices.insert(mesh.vertices.end(), source.begin() + at, source.begin() + at + dimension);
+    };
+    for (const Corner& corner : corners) {
+        append(positions, corner.v, 3);
+        if (has_normal) append(normals, corner.n, 3);
+        if (has_uv) append(uvs, corner.t, 2);
+        if (!colors.empty()) append(colors, corner.v, 3);
+    }
+    for (MeshSubmesh& submesh : mesh.submeshes) submesh.verticesCount = uint32_t(mesh.verticesCount);
+
+    return mesh;
+};
+
+
+/* Stanford PLY, ascii or binary little endian: vertex x y z, nx ny nz, s t (or u v), red green blue and face
+ * vertex_indices lists, triangulated as fans. other elements & properties are skipped */
+inline TextMesh readPlyMesh(const std::string& file) {
+    timeline::Zone zone("readPlyMesh", file);
+    const std::string text = readTextFile(file);
+
+    struct Property {
+        std::string name;
+        std::string type;
+        std::string countType; // list properties only
+    };
+    struct Element {
+        std::string name;
+        size_t count;
+        std::vector<Property> properties;
+    };
+    std::vector<Element> elements;
+    bool binary = false;
+
+    // header
+    size_t position = 0;
+    auto fail = [&file](const std::string& reason) {
+        std::cerr << "Unable to read ply file " + file + ": " + reason << std::endl;
+        exit(EXIT_FAILURE);
+    };
+    while (true) {
+        size_t line_end = text.find('\n', position);
+        if (line_end == std::string::npos) fail("no end_header");
+        std::istringstream line(text.substr(position, line_end - position));
+        position = line_end + 1;
+
+        std::string keyword;
+        line >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            line >> format;
+            if (format == "binary_little_endian") binary = true;
+            else if (format != "ascii") fail("unsupported format " + format);
+        } else if (keyword == "element") {
+            Element element;
+            line >> element.name >> element.count;
+            elements.push_back(element);
+        } else if (keyword == "property" && !elements.empty()) {
+            Property property;
+            line >> property.type;
+            if (property.type == "list") line >> property.countType >> property.type;
+            line >> property.name;
+            elements.back().properties.push_back(property);
+        } else if (keyword == "end_header") {
+            break;
+        }
+    }
+
+    // scalars
+    const char* p = text.c_str() + position;
+    const char* const end = text.c_str() + text.size();
+    auto sizeOf = [](const std::string& type) -> size_t {
+        if (type == "char" || type == "uchar" || type == "int8" || type == "uint8") return 1;
+        if (type == "short" || type == "ushort" || type == "int16" || type == "uint16") return 2;
+        if (type == "double" || type == "float64") return 8;
+        return 4;
+    };
+    auto read = [&](const std::string& type) -> double {
+        if (!binary) {
+            char* next;
+            double value = std::strtod(p, &next);
+            if (next == p) fail("truncated data");
+            p = next;
+            return value;
+        }
+        size_t size = sizeOf(type);
+        if (p + size > end) fail("truncated data");
+        double value;
+        if (type == "char" || type == "int8") { int8_t v; std::memcpy(&v, p, 1); value = v; }
+        else if (type == "uchar" || type == "uint8") { uint8_t v; std::memcpy(&v, p, 1); value = v; }
+        else if (type == "short" || type == "int16") { int16_t v; std::memcpy(&v, p, 2); value = v; }
+        else if (type == "ushort" || type == "uint16") { uint16_t v; std::memcpy(&v, p, 2); value = v; }
+        else if (type == "int" || type == "int32") { int32_t v; std::memcpy(&v, p, 4); value = v; }
+        else if (type == "uint" || type == "uint32") { uint32_t v; std::memcpy(&v, p, 4); value = v; }
+        else if (type == "double" || type == "float64") { double v; std::memcpy(&v, p, 8); value = v; }
+        else { float v; std::memcpy(&v, p, 4); value = v; }
+        p += size;
+        return value;
+    };
+
+    TextMesh mesh;
+    for (const Element& element : elements) {
+        if (element.name == "vertex") {
+            // attribute slot of each property; -1 skipped
+            std::vector<int> slots;
+            bool normal = false, uv = false, color = false;
+            for (const Property& property : element.properties) {
+                const std::string& n = property.name;
+                int slot = n == "x" ? 0 : n == "y" ? 1 : n == "z" ? 2 :
+                           n == "nx" ? 3 : n == "ny" ? 4 : n == "nz" ? 5 :
+                           n == "s" || n == "u" || n == "texture_u" ? 6 : n == "t" || n == "v" || n == "texture_v" ? 7 :
+                           n == "red" ? 8 : n == "green" ? 9 : n == "blue" ? 10 : -1;
+                if (!property.countType.empty()) slot = -2; // list; skipped
+                normal |= slot >= 3 && slot <= 5, uv |= slot == 6 || slot == 7, color |= slot >= 8;
+                slots.push_back(slot);
+            }
+            mesh.normalVecDimension = normal ? 3 : 0;
+            mesh.uvVecDimension = uv ? 2 : 0;
+            mesh.colorVecDimension = color ? 3 : 0;
+            mesh.verticesCount = GLsizei(element.count);
+            mesh.vertices.reserve(size_t(mesh.stride()) * element.count);
+
+            for (size_t i = 0; i < element.count; ++i) {
+                GLfloat values[11] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1};
+                for (size_t k = 0; k < slots.size(); ++k) {
+                    const Property& property = element.properties[k];
+                    if (slots[k] == -2) {
+                        size_t count = size_t(read(property.countType));
+                        for (size_t j = 0; j < count; ++j) read(property.type);
+                        continue;
+                    }
+                    double value = read(property.type);
+                    if (slots[k] < 0) continue;
+                    // integer colors are 0..255
+                    if (slots[k] >= 8 && (property.type == "uchar" || property.type == "uint8")) value /= 255.0;
+                    values[slots[k]] = GLfloat(value);
+                }
+                mesh.vertices.insert(mesh.vertices.end(), values, values + 3);
+                if (normal) mesh.vertices.insert(mesh.vertices.end(), values + 3, values + 6);
+                if (uv) mesh.vertices.insert(mesh.vertices.end(), values + 6, values + 8);
+                if (color) mesh.vertices.insert(mesh.vertices.end(), values + 8, values + 11);
+            }
+        } else {
+            std::vector<GLuint> face;
+            for (size_t i = 0; i < element.count; ++i) {
+                for (const Property& property : element.properties) {
+                    bool indices = element.name == "face" &&
+                                   (property.name == "vertex_indices" || property.name == "vertex_index");
+                    if (property.countType.empty()) {
+                        read(property.type);
+                        continue;
+                    }
+                    size_t count = size_t(read(property.countType));
+                    face.clear();
+                    for (size_t j = 0; j < count; ++j) {
+                        double index = read(property.type);
+                        if (indices && (index < 0.0 || index >= double(UINT32_MAX))) fail("face index out of range");
+                        face.push_back(indices ? GLuint(index) : 0);
+                    }
+                    if (!indices) continue;
+                    for (size_t j = 2; j < face.size(); ++j) {
+                        mesh.indices.push_back(face[0]), mesh.indices.push_back(face[j - 1]);
+                        mesh.indices.push_back(face[j]);
+                    }
+                }
+            }
+        }
+    }
+
+    // faces may come before the vertex element
+    for (GLuint index : mesh.indices) {
+        if (index >= GLuint(mesh.verticesCount)) fail("face index out of range");
+    }
+
+    mesh.submeshes.push_back(MeshSubmesh{0, uint32_t(mesh.indices.size()), 0, uint32_t(mesh.verticesCount)});
+    return mesh;
+};
+
+
+/* text writers; vertex attributes share one index, so every OBJ corner is "i/i/i" */
+inline void writeObjMesh(const std::string& file, const TextMesh& mesh) {
+    FILE* out = std::fopen(file.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Unable to write mesh file: " + file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    const size_t stride = size_t(mesh.stride());
+    const GLint normal = mesh.positionVecDimension, uv = normal + mesh.normalVecDimension;
+    const GLint color = uv + mesh.uvVecDimension;
+
+    for (GLsizei i = 0; i < mesh.verticesCount; ++i) {
+        const GLfloat* v = mesh.vertices.data() + stride * i;
+        if (mesh.colorVecDimension) {
+            std::fprintf(out, "v %g %g %g %g %g %g\n", v[0], v[1], v[2], v[color], v[color + 1], v[color + 2]);
+        } else {
+            std::fprintf(out, "v %g %g %g\n", v[0], v[1], v[2]);
+        }
+    }
+    for (GLsizei i = 0; mesh.uvVecDimension && i < mesh.verticesCount; ++i) {
+        const GLfloat* v = mesh.vertices.data() + stride * i;
+        std::fprintf(out, "vt %g %g\n", v[uv], v[uv + 1]);
+    }
+    for (GLsizei i = 0; mesh.normalVecDimension && i < mesh.verticesCount; ++i) {
+        const GLfloat* v = mesh.vertices.data() + stride * i;
+        std::fprintf(out, "vn %g %g %g\n", v[normal], v[normal + 1], v[normal + 2]);
+    }
+
+    const char* format = mesh.uvVecDimension && mesh.normalVecDimension ? " %u/%u/%u" :
+                         mesh.uvVecDimension ? " %u/%u" : mesh.normalVecDimension ? " %u//%u" : " %u";
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        std::fputc('f', out);
+        for (int k = 0; k < 3; ++k) {
+            GLuint index = mesh.indices[i + k] + 1;
+            std::fprintf(out, format, index, index, index);
+        }
+        std::fputc('\n', out);
+    }
+    std::fclose(out);
+};
+
+inline void writePlyMesh(const std::string& file, const TextMesh& mesh) {
+    FILE* out = std::fopen(file.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Unable to write mesh file: " + file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::fprintf(out, "ply\nformat ascii 1.0\nelement vertex %d\nproperty float x\nproperty float y\n"
+                      "property float z\n", mesh.verticesCount);
+    if (mesh.normalVecDimension) std::fprintf(out, "property float nx\nproperty float ny\nproperty float nz\n");
+    if (mesh.uvVecDimension) std::fprintf(out, "property float s\nproperty float t\n");
+    if (mesh.colorVecDimension) std::fprintf(out, "property float red\nproperty float green\nproperty float blue\n");
+    std::fprintf(out, "element face %zu\nproperty list uchar uint vertex_indices\nend_header\n",
+                 mesh.indices.size() / 3);
+
+    const size_t stride = size_t(mesh.stride());
+    for (GLsizei i = 0; i < mesh.verticesCount; ++i) {
+        const GLfloat* v = mesh.vertices.data() + stride * i;
+        for (size_t k = 0; k < stride; ++k) std::fprintf(out, k ? " %g" : "%g", v[k]);
+        std::fputc('\n', out);
+    }
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        std::fprintf(out, "3 %u %u %u\n", mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]);
+    }
+    std::fclose(out);
+};
+
+
+/* side x side quads of two triangles on the unit square, with normals & uvs; at least triangles triangles */
+inline TextMesh gridMesh(size_t triangles) {
+    const size_t side = std::max<size_t>(1, size_t(std::ceil(std::sqrt(triangles / 2.0))));
+    TextMesh mesh;
+    mesh.normalVecDimension = 3;
+    mesh.uvVecDimension = 2;
+    mesh.verticesCount = GLsizei((side + 1) * (side + 1));
+    mesh.vertices.reserve(size_t(mesh.stride()) * size_t(mesh.verticesCount));
+
+    for (size_t y = 0; y <= side; ++y) {
+        for (size_t x = 0; x <= side; ++x) {
+            GLfloat u = GLfloat(x) / side, v = GLfloat(y) / side;
+            const GLfloat vertex[] = {2.0f * u - 1.0f, 2.0f * v - 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, u, v};
+            mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + 8);
+        }
+    }
+    mesh.indices.reserve(6 * side * side);
+    for (size_t y = 0; y < side; ++y) {
+        for (size_t x = 0; x < side; ++x) {
+            GLuint corner = GLuint(y * (side + 1) + x), above = corner + GLuint(side + 1);
+            const GLuint quad[] = {corner, corner + 1, above + 1, corner, above + 1, above};
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+    mesh.submeshes.push_back(MeshSubmesh{0, uint32_t(mesh.indices.size()), 0, uint32_t(mesh.verticesCount)});
+    return mesh;
+};
+
+
+#endif //_TEXT_MESH_HPP
@@ -0,0 +1,142 @@
+#include "../myGL.hpp"
+#include "../MeshFile.hpp"
+#include "TextMesh.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+
+/* peak resident set size of a finished child in bytes; ru_maxrss is in kilobytes except on macOS */
+static double peakRssBytes(const struct rusage& usage) {
+#ifdef __APPLE__
+    return double(usage.ru_maxrss);
+#else
+    return double(usage.ru_maxrss) * 1024.0;
+#endif
+}
+
+/* run load in a fresh child process so that its peak memory is its own; prints time & peak rss */
+static void measure(const std::string& name, const std::function<unsigned long()>& load) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        std::cerr << "Unable to create pipe" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        close(pipe_fds[0]);
+        auto start = std::chrono::steady_clock::now();
+        unsigned long checksum = load();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ssize_t written = write(pipe_fds[1], &ms, sizeof(ms));
+        written += write(pipe_fds[1], &checksum, sizeof(checksum));
+        _exit(written == ssize_t(sizeof(ms) + sizeof(checksum)) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(pipe_fds[1]);
+
+    double ms = 0.0;
+    unsigned long checksum = 0;
+    bool received = read(pipe_fds[0], &ms, sizeof(ms)) == ssize_t(sizeof(ms)) &&
+                    read(pipe_fds[0], &checksum, sizeof(checksum)) == ssize_t(sizeof(checksum));
+    close(pipe_fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        std::cerr << name << ": child failed" << std::endl;
+        return;
+    }
+    std::printf("%-16s %10.1f ms %10.1f MB peak rss  (checksum %lu)\n", name.c_str(), ms,
+                peakRssBytes(usage) / 1e6, checksum);
+}
+
+/* what an upload reads: every byte of the vertex & index data, straight from the mapping */
+static unsigned long touchMappedMesh(const std::string& file) {
+    MappedMesh mesh(file);
+    if (!mesh.adviseSequential()) std::cerr << "Unable to advise sequential reads of mesh file: " + file << std::endl;
+    const MeshFileHeader& header = mesh.header();
+
+    unsigned long checksum = header.verticesCount + header.indicesCount;
+    const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    const unsigned char* vertices = reinterpret_cast<const unsigned char*>(mesh.vertexData());
+    const unsigned char* indices = reinterpret_cast<const unsigned char*>(mesh.indexData());
+    for (size_t i = 0; i < header.vertexDataSize; i += page) checksum += vertices[i];
+    for (size_t i = 0; i < header.indexDataSize; i += page) checksum += indices[i];
+    return checksum;
+}
+
+/* text parse to the same interleaved vertices & indices the mesh file holds */
+static unsigned long parsedChecksum(const TextMesh& mesh) {
+    return mesh.verticesCount + mesh.indices.size();
+}
+
+static std::string extension(const std::string& file) {
+    size_t dot = file.rfind('.');
+    std::string ext = dot == std::string::npos ? "" : file.substr(dot + 1);
+    for (char& c : ext) c = char(std::tolower(c));
+    return ext;
+}
+
+
+int main(int argc, char* argv[]) {
+    /* usage: MeshConvert input.obj|input.ply output.mesh
+     *        MeshConvert bench [triangles] [directory]; e.g. "bench 10000000 /tmp" compares loading a generated grid
+     *        from OBJ, PLY and the mapped mesh file, each in its own process */
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " input.obj|input.ply output.mesh" << std::endl
+                  << "       " << argv[0] << " bench [triangles] [directory]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (std::string(argv[1]) == "bench") {
+        size_t triangles = argc > 2 ? size_t(std::atoll(argv[2])) : 10000000;
+        std::string directory = argc > 3 ? argv[3] : ".";
+        const std::string obj = directory + "/bench_grid.obj", ply = directory + "/bench_grid.ply",
+                mesh_file = directory + "/bench_grid.mesh";
+
+        {
+            // released before measuring; children would otherwise share its pages
+            TextMesh grid = gridMesh(triangles);
+            std::cout << grid.indices.size() / 3 << " triangles, " << grid.verticesCount << " vertices" << std::endl;
+            writeObjMesh(obj, grid);
+            writePlyMesh(ply, grid);
+            writeMeshFile(mesh_file, grid.header(), grid.indices, grid.submeshes);
+        }
+
+        measure("baseline", []() { return 0ul; });
+        measure("obj parse", [&obj]() { return parsedChecksum(readObjMesh(obj)); });
+        measure("ply parse", [&ply]() { return parsedChecksum(readPlyMesh(ply)); });
+        measure("mesh mmap", [&mesh_file]() { return touchMappedMesh(mesh_file); });
+
+        std::remove(obj.c_str());
+        std::remove(ply.c_str());
+        std::remove(mesh_file.c_str());
+        return EXIT_SUCCESS;
+    }
+
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " input.obj|input.ply output.mesh" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string input = argv[1], output = argv[2];
+    std::string ext = extension(input);
+    if (ext != "obj" && ext != "ply") {
+        std::cerr << "Unsupported mesh format: " + input << std::endl;
+        return EXIT_FAILURE;
+    }
+    TextMesh mesh = ext == "obj" ? readObjMesh(input) : readPlyMesh(input);
+    writeMeshFile(output, mesh.header(), mesh.indices, mesh.submeshes);
+
+    std::cout << output << ": " << mesh.verticesCount << " vertices (" << mesh.positionVecDimension << "/"
+              << mesh.normalVecDimension << "/" << mesh.uvVecDimension << "/" << mesh.colorVecDimension
+              << " PNTC), " << mesh.indices.size() / 3 << " triangles, " << mesh.submeshes.size() << " submeshes"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,342 @@
+//
+// Created by pallas athena on 16/10/8.
+//
+
+#ifndef _MESH_FILE_HPP
+#define _MESH_FILE_HPP
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "myGL.hpp"
+
+
+/* binary mesh container, laid out to be mapped and handed to glBufferData as is: a fixed header, then the vertex
+ * data interleaved "PNTC" as VertexBufferHeader<GLfloat> describes it, the GLuint indices and the submesh ranges,
+ * each section aligned to SECTION_ALIGNMENT bytes. native endianness; MeshConvert writes it from OBJ or PLY. */
+namespace meshfile {
+    const char MAGIC[4] = {'G', 'L', 'M', 'F'};
+    const uint32_t VERSION = 1;
+    const uint64_t SECTION_ALIGNMENT = 64;
+};
+
+struct MeshFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t verticesCount;
+    uint32_t submeshesCount;
+    uint64_t indicesCount;
+
+    /* vertex layout; same fields as VertexBufferHeader */
+    int32_t positionVecDimension;
+    int32_t normalVecDimension;
+    int32_t uvVecDimension;
+    int32_t colorVecDimension;
+    uint32_t dataType; // GL_FLOAT
+    uint32_t indexType; // GL_UNSIGNED_INT
+
+    /* axis-aligned bounds of the positions; unused components are 0 */
+    float boundsMin[3];
+    float boundsMax[3];
+
+    /* byte ranges within the file */
+    uint64_t vertexDataOffset;
+    uint64_t vertexDataSize;
+    uint64_t indexDataOffset;
+    uint64_t indexDataSize;
+    uint64_t submeshDataOffset;
+
+    GLsizei stride() const {
+        return GLsizei(sizeof(GLfloat)) *
+               (positionVecDimension + normalVecDimension + uvVecDimension + colorVecDimension);
+    };
+};
+static_assert(sizeof(MeshFileHeader) == 112, "mesh file header layout changed; bump meshfile::VERSION");
+
+/* part of a mesh drawn with one glDrawElementsBaseVertex; e.g. one OBJ group */
+struct MeshSubmesh {
+    uint32_t firstIndex;
+    uint32_t indicesCount;
+    int32_t baseVertex;
+    uint32_t verticesCount;
+
+    /* byte offset of the first index, as glDrawElements* expects it */
+    const void* indexDataOffset() const {
+        return (void*)(sizeof(GLuint) * this->firstIndex);
+    };
+};
+
+
+/* write vertices described by header, indices and submesh ranges; one submesh covering everything if none given */
+inline void writeMeshFile(const std::string& file, const VertexBufferHeader<GLfloat>& header,
+                          const std::vector<GLuint>& indices, std::vector<MeshSubmesh> submeshes = {}) {
+    timeline::Zone zone("writeMeshFile", file);
+
+    if (submeshes.empty()) {
+        submeshes.push_back(MeshSubmesh{0, uint32_t(indices.size()), 0, uint32_t(header.verticesCount())});
+    }
+
+    MeshFileHeader mesh;
+    std::memset(&mesh, 0, sizeof(mesh));
+    std::memcpy(mesh.magic, meshfile::MAGIC, sizeof(meshfile::MAGIC));
+    mesh.version = meshfile::VERSION;
+    mesh.verticesCount = uint32_t(header.verticesCount());
+    mesh.submeshesCount = uint32_t(submeshes.size());
+    mesh.indicesCount = indices.size();
+    mesh.positionVecDimension = header.positionVecDimension();
+    mesh.normalVecDimension = header.normalVecDimension();
+    mesh.uvVecDimension = header.uvVecDimension();
+    mesh.colorVecDimension = header.colorVecDimension();
+    mesh.dataType = GL_FLOAT;
+    mesh.indexType = GL_UNSIGNED_INT;
+
+    // bounds
+    const int dimension = std::min(header.positionVecDimension(), 3);
+    const size_t stride = size_t(header.stride()) / sizeof(GLfloat);
+    for (int k = 0; k < 3; ++k) {
+        mesh.boundsMin[k] = k < dimension && mesh.verticesCount ? FLT_MAX : 0.0f;
+        mesh.boundsMax[k] = k < dimension && mesh.verticesCount ? -FLT_MAX : 0.0f;
+    }
+    for (size_t i = 0; i < mesh.verticesCount; ++i) {
+        const GLfloat* position = header.bufferData() + stride * i;
+        for (int k = 0; k < dimension; ++k) {
+            mesh.boundsMin[k] = std::min(mesh.boundsMin[k], position[k]);
+            mesh.boundsMax[k] = std::max(mesh.boundsMax[k], position[k]);
+        }
+    }
+
+    // sections
+    auto align = [](uint64_t offset) {
+        return (offset + meshfile::SECTION_ALIGNMENT - 1) / meshfile::SECTION_ALIGNMENT * meshfile::SECTION_ALIGNMENT;
+    };
+    mesh.vertexDataOffset = align(sizeof(mesh));
+    mesh.vertexDataSize = uint64_t(header.stride()) * mesh.verticesCount;
+    mesh.indexDataOffset = align(mesh.vertexDataOffset + mesh.vertexDataSize);
+    mesh.indexDataSize = sizeof(GLuint) * indices.size();
+    mesh.submeshDataOffset = align(mesh.indexDataOffset + mesh.indexDataSize);
+
+    FILE* out = std::fopen(file.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Unable to write mesh file: " + file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    uint64_t written = 0;
+    auto write = [&out, &written](uint64_t offset, const void* data, uint64_t size) {
+        static const char padding[meshfile::SECTION_ALIGNMENT] = {0};
+        std::fwrite(padding, 1, size_t(offset - written), out);
+        if (size) std::fwrite(data, 1, size_t(size), out);
+        written = offset + size;
+    };
+    write(0, &mesh, sizeof(mesh));
+    write(mesh.vertexDataOffset, header.bufferData(), mesh.vertexDataSize);
+    write(mesh.indexDataOffset, indices.data(), mesh.indexDataSize);
+    write(mesh.submeshDataOffset, submeshes.data(), sizeof(MeshSubmesh) * submeshes.size());
+
+    if (std::ferror(out)) {
+        std::cerr << "Unable to write mesh file: " + file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::fclose(out);
+};
+
+
+/* gl objects of an uploaded mesh; attribute locations are sequential in PNTC order, as in MeshBuffer */
+struct UploadedMesh {
+    GLuint vertexArray = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    std::vector<MeshSubmesh> submeshes;
+
+    void draw(const MeshSubmesh& submesh, GLenum mode = GL_TRIANGLES) const {
+        glBindVertexArray(this->vertexArray);
+        glDrawElementsBaseVertex(mode, GLsizei(submesh.indicesCount), GL_UNSIGNED_INT, submesh.indexDataOffset(),
+                                 submesh.baseVertex);
+    };
+
+    void drawAll(GLenum mode = GL_TRIANGLES) const {
+        for (const MeshSubmesh& submesh : this->submeshes) this->draw(submesh, mode);
+    };
+
+    void destroy() {
+        if (this->vertexArray) glDeleteVertexArrays(1, &this->vertexArray);
+        if (this->vertexBuffer) glDeleteBuffers(1, &this->vertexBuffer);
+        if (this->indexBuffer) glDeleteBuffers(1, &this->indexBuffer);
+        this->vertexArray = this->vertexBuffer = this->indexBuffer = 0;
+    };
+};
+
+
+/* read-only mapping of a mesh file; nothing is parsed or copied, pages are read in on first touch */
+class MappedMesh {
+private:
+    std::string m_file;
+    const unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+
+    /* [offset, offset + size) lies within the mapping, without overflowing */
+    bool contains(uint64_t offset, uint64_t size) const {
+        return offset <= this->m_size && size <= this->m_size - offset;
+    };
+
+    void fail(const std::string& reason) const {
+        std::cerr << "Invalid mesh file " + this->m_file + ": " + reason << std::endl;
+        exit(EXIT_FAILURE);
+    };
+
+public:
+    explicit MappedMesh(const std::string& file) : m_file(file) {
+        timeline::Zone zone("MappedMesh", file);
+
+        int fd = open(file.c_str(), O_RDONLY);
+        struct stat status;
+        if (fd < 0 || fstat(fd, &status) != 0 || size_t(status.st_size) < sizeof(MeshFileHeader)) {
+            std::cerr << "Unable to read mesh file: " + file << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        this->m_size = size_t(status.st_size);
+        void* data = mmap(nullptr, this->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            std::cerr << "Unable to map mesh file: " + file << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        this->m_data = static_cast<const unsigned char*>(data);
+
+        const MeshFileHeader& mesh = this->header();
+        bool valid = std::memcmp(mesh.magic, meshfile::MAGIC, sizeof(meshfile::MAGIC)) == 0 &&
+                     mesh.version == meshfile::VERSION && mesh.dataType == GL_FLOAT &&
+                     mesh.indexType == GL_UNSIGNED_INT;
+        if (!valid) {
+            std::cerr << "Not a version " << meshfile::VERSION << " mesh file: " + file << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        /* sections; sizes are checked against the counts before anything is multiplied past the file size */
+        const int32_t dimensions[4] = {mesh.positionVecDimension, mesh.normalVecDimension, mesh.uvVecDimension,
+                                       mesh.colorVecDimension};
+        for (int32_t dimension : dimensions) {
+            if (dimension < 0 || dimension > 4) this->fail("bad vertex layout");
+        }
+        if (mesh.positionVecDimension == 0) this->fail("bad vertex layout");
+        if (mesh.vertexDataOffset % sizeof(GLfloat) || mesh.indexDataOffset % sizeof(GLuint) ||
+            mesh.submeshDataOffset % sizeof(uint32_t)) {
+            this->fail("misaligned section");
+        }
+        if (mesh.vertexDataSize != uint64_t(mesh.stride()) * mesh.verticesCount ||
+            mesh.indicesCount > this->m_size / sizeof(GLuint) ||
+            mesh.indexDataSize != sizeof(GLuint) * mesh.indicesCount ||
+            !this->contains(mesh.vertexDataOffset, mesh.vertexDataSize) ||
+            !this->contains(mesh.indexDataOffset, mesh.indexDataSize) ||
+            !this->contains(mesh.submeshDataOffset, uint64_t(sizeof(MeshSubmesh)) * mesh.submeshesCount)) {
+            this->fail("section out of range");
+        }
+
+        /* submeshes must draw within the index & vertex data; the indices themselves are checked by upload() */
+        for (uint32_t i = 0; i < mesh.submeshesCount; ++i) {
+            const MeshSubmesh& submesh = this->submeshes()[i];
+            if (uint64_t(submesh.firstIndex) + submesh.indicesCount > mesh.indicesCount ||
+                submesh.baseVertex < 0 ||
+                uint64_t(submesh.baseVertex) + submesh.verticesCount > mesh.verticesCount) {
+                this->fail("submesh " + std::to_string(i) + " out of range");
+            }
+        }
+    };
+
+    ~MappedMesh() {
+        if (this->m_data) munmap(const_cast<unsigned char*>(this->m_data), this->m_size);
+    };
+
+    MappedMesh(const MappedMesh&) = delete;
+    MappedMesh& operator=(const MappedMesh&) = delete;
+
+public:
+    const MeshFileHeader& header() const {
+        return *reinterpret_cast<const MeshFileHeader*>(this->m_data);
+    };
+
+    const GLfloat* vertexData() const {
+        return reinterpret_cast<const GLfloat*>(this->m_data + this->header().vertexDataOffset);
+    };
+
+    const GLuint* indexData() const {
+        return reinterpret_cast<const GLuint*>(this->m_data + this->header().indexDataOffset);
+    };
+
+    const MeshSubmesh* submeshes() const {
+        return reinterpret_cast<const MeshSubmesh*>(this->m_data + this->header().submeshDataOffset);
+    };
+
+    size_t fileSize() const {
+        return this->m_size;
+    };
+
+    /* hint that the data will be read front to back soon, e.g. right before upload(). advice values are not flags,
+     * so each is given on its own; false if the kernel refused either, which only costs the read-ahead */
+    bool adviseSequential() const {
+        void* data = const_cast<unsigned char*>(this->m_data);
+        bool sequential = madvise(data, this->m_size, MADV_SEQUENTIAL) == 0;
+        bool will_need = madvise(data, this->m_size, MADV_WILLNEED) == 0;
+        return sequential && will_need;
+    };
+
+public:
+    /* vertex & index buffers filled straight from the mapping; the driver's copy is the only one */
+    UploadedMesh upload(GLenum usage = GL_STATIC_DRAW) const {
+        timeline::Zone zone("MappedMesh::upload");
+        const MeshFileHeader& mesh = this->header();
+        this->adviseSequential();
+
+        /* out-of-range indices would read past the vertex buffer on the gpu; the upload touches every index anyway */
+        for (uint32_t i = 0; i < mesh.submeshesCount; ++i) {
+            const MeshSubmesh& submesh = this->submeshes()[i];
+            const GLuint* indices = this->indexData() + submesh.firstIndex;
+            for (uint32_t k = 0; k < submesh.indicesCount; ++k) {
+                if (uint64_t(indices[k]) + uint64_t(submesh.baseVertex) >= mesh.verticesCount) {
+                    this->fail("index out of range in submesh " + std::to_string(i));
+                }
+            }
+        }
+
+        UploadedMesh uploaded;
+        uploaded.submeshes.assign(this->submeshes(), this->submeshes() + mesh.submeshesCount);
+
+        glGenVertexArrays(1, &uploaded.vertexArray);
+        glBindVertexArray(uploaded.vertexArray);
+
+        glGenBuffers(1, &uploaded.vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, uploaded.vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(mesh.vertexDataSize), this->vertexData(), usage);
+
+        glGenBuffers(1, &uploaded.indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, uploaded.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(mesh.indexDataSize), this->indexData(), usage);
+
+        const GLint dimensions[4] = {mesh.positionVecDimension, mesh.normalVecDimension, mesh.uvVecDimension,
+                                     mesh.colorVecDimension};
+        GLuint location = 0;
+        GLintptr offset = 0;
+        for (GLint dimension : dimensions) {
+            if (dimension == 0) continue;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, dimension, GL_FLOAT, GL_FALSE, mesh.stride(), (void*)offset);
+            offset += GLintptr(sizeof(GLfloat)) * dimension;
+            ++location;
+        }
+
+        glBindVertexArray(0);
+        return uploaded;
+    };
+};
+
+
+#endif //_MESH_FILE_HPP
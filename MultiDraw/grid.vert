@@ -0,0 +1,19 @@
+#version 330 core
+
+// Input data
+layout(location = 0) in vec3 position;
+
+// instanced mode only; the vertex buffer then holds the triangle of cell 0 alone
+uniform int gridSide;
+uniform float cellSize;
+
+void main(){
+
+    vec2 offset = vec2(0.0);
+    if (gridSide > 0)
+        offset = vec2(gl_InstanceID % gridSide, gl_InstanceID / gridSide) * cellSize;
+
+    gl_Position.xyz = vec3(position.xy + offset, position.z);
+    gl_Position.w = 1.0;
+}
+
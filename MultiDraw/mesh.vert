@@ -0,0 +1,18 @@
+#version 330 core
+
+// Input data; positions come first in a mesh file, other attributes are ignored
+layout(location = 0) in vec3 position;
+
+// bounds of the mesh file, fitted to the viewport keeping the aspect ratio
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+void main(){
+
+    vec3 extent = max(boundsMax - boundsMin, vec3(1e-6));
+    float scale = 1.8 / max(extent.x, extent.y);
+    vec2 center = 0.5 * (boundsMin.xy + boundsMax.xy);
+
+    gl_Position.xyz = vec3((position.xy - center) * scale, 0.0);
+    gl_Position.w = 1.0;
+}
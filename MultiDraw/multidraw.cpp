@@ -0,0 +1,288 @@
+#include "../myGL.hpp"
+#include "../Context.hpp"
+#include "../IndirectDraw.hpp"
+#include "../MeshBuffer.hpp"
+#include "../MeshFile.hpp"
+#include "../VertexPulling.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+
+/* Constants. */
+static const GLint width = 600;
+static const GLint height = 600;
+static const int frames_to_measure = 300;
+
+const std::string vertex_shader_file = "grid.vert";
+const std::string fragment_shader_file = "solid_color.frag";
+const std::string pulling_vertex_shader_file = "polygon.vert";
+const std::string mesh_vertex_shader_file = "mesh.vert";
+
+/* submission path under test; pulling draws regular triangles of about the same area without any vertex buffer,
+ * occlusion draws directly behind an occluder covering most of the grid and culls each triangle by its cell, meshes
+ * allocates each triangle as a mesh of its own in a shared MeshBuffer, mesh draws each submesh of a mesh file
+ * written by MeshConvert */
+enum class SubmitMode { Direct, Instanced, Indirect, Pulling, Occlusion, Meshes, Mesh };
+
+
+/* one small triangle per cell of a side x side grid covering the viewport, filled row by row */
+std::vector<GLfloat> gridTriangles(int count, int side) {
+    std::vector<GLfloat> vertices;
+    const GLfloat cell = 2.0f / side;
+
+    for (int i = 0; i < count; ++i) {
+        GLfloat x = -1.0f + cell * (i % side), y = -1.0f + cell * (i / side);
+        std::vector<GLfloat> triangle = {
+                x + 0.1f * cell, y + 0.1f * cell, 0.0f,
+                x + 0.9f * cell, y + 0.1f * cell, 0.0f,
+                x + 0.5f * cell, y + 0.9f * cell, 0.0f
+        };
+        vertices.insert(vertices.end(), triangle.begin(), triangle.end());
+    }
+
+    return vertices;
+};
+
+/* opaque square in front of the grid covering [-1, 0.5]^2, as two triangles */
+std::vector<GLfloat> occluderQuad() {
+    return {
+            -1.0f, -1.0f, -0.5f,  0.5f, -1.0f, -0.5f,  0.5f, 0.5f, -0.5f,
+            -1.0f, -1.0f, -0.5f,  0.5f, 0.5f, -0.5f,  -1.0f, 0.5f, -0.5f
+    };
+};
+
+/* bounds of the triangle of cell i, as laid out by gridTriangles() */
+BoundingBox cellBox(int i, int side) {
+    const GLfloat cell = 2.0f / side;
+    GLfloat x = -1.0f + cell * (i % side), y = -1.0f + cell * (i / side);
+    return BoundingBox{{x + 0.1f * cell, y + 0.1f * cell, 0.0f}, {x + 0.9f * cell, y + 0.9f * cell, 0.0f}};
+};
+
+
+/* gl context */
+class Window : public GLContext {
+
+private:
+    SubmitMode mode;
+    int draws_count;
+    int grid_side;
+    std::string mesh_file;
+
+    GLuint vertex_array; /* VAO object */
+    GLuint vertex_buffer; /* VBO object */
+    GLuint program_id; /* shaders */
+    std::unique_ptr<IndirectDrawBuffer<DrawArraysIndirectCommand>> indirect_buffer; /* created once the context exists */
+    PolygonPulling polygons;
+    UploadedMesh mesh;
+    MeshBuffer mesh_buffer{VertexFormat{3, 0, 0, 0, GL_FLOAT, GLsizei(sizeof(GLfloat))}};
+    std::vector<MeshHandle> mesh_handles;
+
+    int frames = 0;
+    std::chrono::nanoseconds submission_time{0};
+    std::chrono::nanoseconds setup_time{0}; /* vertex generation & upload */
+
+public:
+    /* mesh mode ignores draws_count; there is one draw per submesh of mesh_file */
+    Window(SubmitMode mode, int draws_count, const std::string& mesh_file = "") :
+            mode(mode), draws_count(draws_count), grid_side(int(std::ceil(std::sqrt(float(draws_count))))),
+            mesh_file(mesh_file) {};
+
+private:
+    void initialize() {
+        auto start = std::chrono::steady_clock::now();
+        indirect_buffer.reset(new IndirectDrawBuffer<DrawArraysIndirectCommand>(queryIndirectSupport()));
+
+        /* nothing to generate or upload; shapes come from gl_VertexID & gl_InstanceID */
+        if (mode == SubmitMode::Pulling) {
+            program_id = compileShaders(pulling_vertex_shader_file, fragment_shader_file);
+            polygons.initialize(program_id);
+            vertex_buffer = vertex_array = 0;
+            setup_time = std::chrono::steady_clock::now() - start;
+            return;
+        }
+
+        /* buffers are filled straight from the mapping, which is closed again once uploaded */
+        if (mode == SubmitMode::Mesh) {
+            MappedMesh mapped(mesh_file);
+            const MeshFileHeader& header = mapped.header();
+            mesh = mapped.upload();
+            draws_count = int(mesh.submeshes.size());
+            vertex_buffer = vertex_array = 0;
+
+            program_id = compileShaders(mesh_vertex_shader_file, fragment_shader_file);
+            glUseProgram(program_id);
+            glUniform3fv(glGetUniformLocation(program_id, "boundsMin"), 1, header.boundsMin);
+            glUniform3fv(glGetUniformLocation(program_id, "boundsMax"), 1, header.boundsMax);
+            setup_time = std::chrono::steady_clock::now() - start;
+            return;
+        }
+
+        /* one allocation per triangle; pages hold all of them, so drawAll() is one multi-draw per page */
+        if (mode == SubmitMode::Meshes) {
+            const std::vector<GLuint> indices = {0, 1, 2};
+            std::vector<GLfloat> vertex_data = gridTriangles(draws_count, grid_side);
+            for (int i = 0; i < draws_count; ++i) {
+                std::vector<GLfloat> triangle(vertex_data.begin() + 9 * i, vertex_data.begin() + 9 * (i + 1));
+                mesh_handles.push_back(mesh_buffer.allocate(VertexBufferHeader<GLfloat>(triangle, 3, 3, 0, 0, 0),
+                                                            indices));
+            }
+            vertex_buffer = vertex_array = 0;
+
+            program_id = compileShaders(vertex_shader_file, fragment_shader_file);
+            glUseProgram(program_id);
+            glUniform1i(glGetUniformLocation(program_id, "gridSide"), 0);
+            setup_time = std::chrono::steady_clock::now() - start;
+            return;
+        }
+
+        /* instanced mode only needs the triangle of the first cell */
+        std::vector<GLfloat> vertex_data = gridTriangles(mode == SubmitMode::Instanced ? 1 : draws_count, grid_side);
+        if (mode == SubmitMode::Occlusion) {
+            std::vector<GLfloat> occluder = occluderQuad();
+            vertex_data.insert(vertex_data.end(), occluder.begin(), occluder.end());
+            glEnable(GL_DEPTH_TEST);
+        }
+
+        /* create VBO object */
+        glGenBuffers(1, &vertex_buffer);
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertex_data.size(), vertex_data.data(), GL_STATIC_DRAW);
+        }
+
+        /* create VAO object */
+        glGenVertexArrays(1, &vertex_array);
+        {
+            glBindVertexArray(vertex_array);
+
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(
+                    0, // counterpart of layout in the shader
+                    3, // components per vertex
+                    GL_FLOAT, // data type
+                    GL_FALSE, // whether normalized
+                    0, // stride
+                    (void*)0 // offset
+            );
+        }
+
+        /* create and compile shaders */
+        program_id = compileShaders(vertex_shader_file, fragment_shader_file);
+
+        /* Apply the shader */
+        glUseProgram(program_id);
+        glUniform1i(glGetUniformLocation(program_id, "gridSide"), mode == SubmitMode::Instanced ? grid_side : 0);
+        glUniform1f(glGetUniformLocation(program_id, "cellSize"), 2.0f / grid_side);
+
+        /* static scene; commands are written once */
+        if (mode == SubmitMode::Indirect) {
+            for (int i = 0; i < draws_count; ++i) {
+                indirect_buffer->commands.push_back(DrawArraysIndirectCommand{3, 1, GLuint(3 * i), 0});
+            }
+            indirect_buffer->upload();
+        }
+        setup_time = std::chrono::steady_clock::now() - start;
+    };
+
+    void draw() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        auto start = std::chrono::steady_clock::now();
+        switch (mode) {
+            case SubmitMode::Direct:
+                for (int i = 0; i < draws_count; ++i) {
+                    glDrawArrays(GL_TRIANGLES, 3 * i, 3);
+                }
+                break;
+            case SubmitMode::Instanced:
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 3, draws_count);
+                break;
+            case SubmitMode::Indirect:
+                indirect_buffer->submit(GL_TRIANGLES);
+                break;
+            case SubmitMode::Pulling:
+                // circumradius of a whole half cell; about the area of the 0.8 x 0.8 cell triangles of the others
+                polygons.draw(1.0f, 3, grid_side, draws_count);
+                break;
+            case SubmitMode::Occlusion:
+                glDrawArrays(GL_TRIANGLES, 3 * draws_count, 6);
+                occlusion.beginTests();
+                for (int i = 0; i < draws_count; ++i) occlusion.test(size_t(i), cellBox(i, grid_side));
+                occlusion.endTests();
+                for (int i = 0; i < draws_count; ++i) {
+                    occlusion.draw(size_t(i), [i]() { glDrawArrays(GL_TRIANGLES, 3 * i, 3); });
+                }
+                break;
+            case SubmitMode::Meshes:
+                mesh_buffer.drawAll(mesh_handles);
+                break;
+            case SubmitMode::Mesh:
+                mesh.drawAll();
+                break;
+        }
+        submission_time += std::chrono::steady_clock::now() - start;
+
+        if (++frames == frames_to_measure) glfwSetWindowShouldClose(glfwGetCurrentContext(), GL_TRUE);
+    };
+
+    void destroy() {
+        static const char* mode_names[] = {"direct", "instanced", "indirect", "pulling", "occlusion", "meshes",
+                                           "mesh"};
+        static const char* support_names[] = {"cpu fallback", "single indirect", "multi indirect"};
+
+        std::cout << mode_names[int(mode)] << " (" << support_names[int(indirect_buffer->support())] << "), "
+                  << draws_count << " draws: "
+                  << std::chrono::duration<double, std::micro>(submission_time).count() / frames
+                  << " us cpu submission per frame over " << frames << " frames, "
+                  << std::chrono::duration<double, std::milli>(setup_time).count() << " ms setup" << std::endl;
+        pacer.report(std::cout);
+        mesh_buffer.report(std::cout);
+
+        /* Destroy gl objects */
+        indirect_buffer->destroy();
+        indirect_buffer.reset();
+        glDeleteBuffers(1, &vertex_buffer);
+        glDeleteVertexArrays(1, &vertex_array);
+        glDeleteProgram(program_id);
+        polygons.destroy();
+        mesh.destroy();
+        for (const MeshHandle& handle : mesh_handles) mesh_buffer.free(handle);
+        mesh_buffer.destroy();
+    };
+};
+
+
+int main(int argc, char* argv[]) {
+    /* usage: MultiDraw [direct|instanced|indirect|pulling|occlusion|meshes] [draws] [anti-aliasing]; e.g. 1000, 10000 and
+     * 100000 draws per mode. anti-aliasing is none, msaa2/4/8, offscreen2/4/8 or fxaa; see AntiAliasMode::parse().
+     * MultiDraw mesh file.mesh [anti-aliasing] draws a file written by MeshConvert instead of the grid */
+    SubmitMode mode = SubmitMode::Indirect;
+    if (argc > 1) {
+        std::string name(argv[1]);
+        mode = name == "direct" ? SubmitMode::Direct : name == "instanced" ? SubmitMode::Instanced :
+               name == "pulling" ? SubmitMode::Pulling : name == "occlusion" ? SubmitMode::Occlusion :
+               name == "meshes" ? SubmitMode::Meshes : name == "mesh" ? SubmitMode::Mesh : SubmitMode::Indirect;
+    }
+    if (mode == SubmitMode::Mesh && argc < 3) {
+        std::cerr << "Usage: MultiDraw mesh file.mesh [anti-aliasing]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    int draws_count = mode == SubmitMode::Mesh ? 1 : argc > 2 ? std::atoi(argv[2]) : 1000;
+    if (draws_count < 1) {
+        std::cerr << "Invalid draws count " << argv[2] << ": at least one draw is needed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Window w(mode, draws_count, mode == SubmitMode::Mesh ? argv[2] : "");
+    w.framePacer().setBenchmarkMode(); // uncapped; presentation must not hide submission cost
+    if (argc > 3) w.setAntiAliasMode(AntiAliasMode::parse(argv[3]));
+    w.setEnvironment();
+    w.createWindow(width, height, "Multi draw");
+
+    w.mainloop();
+
+    return EXIT_SUCCESS;
+}
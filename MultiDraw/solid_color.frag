@@ -0,0 +1,12 @@
+#version 330 core
+
+// Ouput data
+out vec3 color;
+
+void main()
+{
+
+	// Output color = blue
+	color = vec3(61.0 / 255.0, 156.0 / 255.0, 174.0 / 255.0);
+
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+//
+// Created by pallas athena on 16/10/12.
+//
+
+#ifndef _OCCLUSION_HPP
+#define _OCCLUSION_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "myGL.hpp"
+
+
+/* axis-aligned box in the space the proxy transform maps to clip space */
+struct BoundingBox {
+    GLfloat min[3];
+    GLfloat max[3];
+};
+
+
+/* 14-vertex triangle strip of a unit cube from gl_VertexID, stretched over the box; no vertex buffer */
+static const char* const OCCLUSION_PROXY_VERTEX_SHADER = R"(#version 330 core
+
+uniform mat4 transform;
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+void main(){
+    int bit = 1 << gl_VertexID;
+    vec3 corner = vec3((0x287a & bit) != 0, (0x02af & bit) != 0, (0x31e3 & bit) != 0);
+    gl_Position = transform * vec4(mix(boxMin, boxMax, corner), 1.0);
+}
+)";
+
+/* color writes are masked off while testing; only samples passing the depth test count */
+static const char* const OCCLUSION_PROXY_FRAGMENT_SHADER = R"(#version 330 core
+
+out vec4 color;
+
+void main(){
+    color = vec4(1.0);
+}
+)";
+
+
+/* occlusion culling of expensive draws with bounding box proxies. each frame the caller draws its occluders first,
+ * then tests objects between beginTests() / endTests(): the box is rasterized without color or depth writes inside
+ * a GL_ANY_SAMPLES_PASSED query. draw() submits the object under glBeginConditionalRender, so the gpu drops it when
+ * that query has already failed, and skips it on the cpu altogether while the latest result read back says
+ * occluded. results are polled at the start of each frame and never waited for, so an object coming back into view
+ * shows up once its query is read, usually a frame or two late. ids are small indices chosen by the caller; gl
+ * calls require the owning context to be current. */
+class OcclusionCuller {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct FrameStats {
+        unsigned long tested = 0; // proxies drawn
+        unsigned long culled = 0; // skipped on the cpu because of an earlier result
+        unsigned long conditional = 0; // submitted under conditional rendering
+    };
+
+private:
+    struct Pending {
+        GLuint query;
+        unsigned long frame;
+        Clock::time_point issued;
+    };
+
+    struct Object {
+        std::deque<Pending> pending; // in submission order
+        GLuint current = 0; // query issued this frame; 0 if untested
+        bool occluded = false; // latest result read back
+    };
+
+    std::vector<Object> m_objects;
+    std::vector<GLuint> m_free; // unused query objects
+    std::vector<GLuint> m_all;
+    size_t m_maxInFlight; // per object; no new test while the gpu is that far behind
+
+    GLuint m_program = 0;
+    GLuint m_vertexArray = 0; // empty; core profile needs one bound to draw
+    GLint m_transformLocation = -1;
+    GLint m_boxMinLocation = -1;
+    GLint m_boxMaxLocation = -1;
+
+    /* state replaced between beginTests() and endTests() */
+    GLint m_savedProgram = 0;
+    GLint m_savedVertexArray = 0;
+    GLboolean m_savedColorMask[4] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
+    GLboolean m_savedDepthMask = GL_TRUE;
+
+    /* metrics */
+    unsigned long m_frame = 0;
+    FrameStats m_current;
+    FrameStats m_last;
+    FrameStats m_total;
+    unsigned long m_framesUsed = 0; // frames with at least one test or draw
+    unsigned long m_results = 0;
+    unsigned long m_occludedResults = 0;
+    unsigned long m_totalLatencyFrames = 0;
+    unsigned long m_maxLatencyFrames = 0;
+    Clock::duration m_totalLatency = Clock::duration::zero();
+    Clock::duration m_maxLatency = Clock::duration::zero();
+
+public:
+    OcclusionCuller(size_t max_in_flight = 3) : m_maxInFlight(max_in_flight) {};
+
+    ~OcclusionCuller() {
+        // gl objects can only be deleted with a current context; destroy() is the caller's duty
+        assert(this->m_all.empty() && this->m_program == 0);
+    };
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+public:
+    /* before the frame is drawn; reads back whatever results have arrived */
+    void beginFrame() {
+        ++this->m_frame;
+        this->m_current = FrameStats();
+        for (Object& object : this->m_objects) {
+            object.current = 0;
+            this->collect(object);
+        }
+    };
+
+    /* after the frame is drawn */
+    void endFrame() {
+        this->m_last = this->m_current;
+        if (this->m_current.tested == 0 && this->m_current.culled == 0 && this->m_current.conditional == 0) return;
+
+        ++this->m_framesUsed;
+        this->m_total.tested += this->m_current.tested;
+        this->m_total.culled += this->m_current.culled;
+        this->m_total.conditional += this->m_current.conditional;
+    };
+
+    /* after the occluders are drawn; transform is a column-major 4x4 from box space to clip space, identity if
+     * null. keeps the bound framebuffer & depth test, masks color & depth writes */
+    void beginTests(const GLfloat* transform = nullptr) {
+        static const GLfloat identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+        if (this->m_program == 0) {
+            this->m_program = compileShaderSources(OCCLUSION_PROXY_VERTEX_SHADER, OCCLUSION_PROXY_FRAGMENT_SHADER);
+            this->m_transformLocation = glGetUniformLocation(this->m_program, "transform");
+            this->m_boxMinLocation = glGetUniformLocation(this->m_program, "boxMin");
+            this->m_boxMaxLocation = glGetUniformLocation(this->m_program, "boxMax");
+            glGenVertexArrays(1, &this->m_vertexArray);
+        }
+
+        glGetIntegerv(GL_CURRENT_PROGRAM, &this->m_savedProgram);
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &this->m_savedVertexArray);
+        glGetBooleanv(GL_COLOR_WRITEMASK, this->m_savedColorMask);
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &this->m_savedDepthMask);
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glUseProgram(this->m_program);
+        glUniformMatrix4fv(this->m_transformLocation, 1, GL_FALSE, transform ? transform : identity);
+        glBindVertexArray(this->m_vertexArray);
+    };
+
+    /* issue the proxy query of object id for this frame */
+    void test(size_t id, const BoundingBox& box) {
+        Object& object = this->object(id);
+        if (object.pending.size() >= this->m_maxInFlight) return;
+
+        GLuint query = this->query();
+        glUniform3fv(this->m_boxMinLocation, 1, box.min);
+        glUniform3fv(this->m_boxMaxLocation, 1, box.max);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 14);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        object.pending.push_back(Pending{query, this->m_frame, Clock::now()});
+        object.current = query;
+        ++this->m_current.tested;
+    };
+
+    /* back to the caller's program, vertex array & write masks */
+    void endTests() {
+        glColorMask(this->m_savedColorMask[0], this->m_savedColorMask[1], this->m_savedColorMask[2],
+                    this->m_savedColorMask[3]);
+        glDepthMask(this->m_savedDepthMask);
+        glUseProgram(GLuint(this->m_savedProgram));
+        glBindVertexArray(GLuint(this->m_savedVertexArray));
+    };
+
+    /* call submit() unless object id is known to be occluded; conditional on this frame's query if it was tested.
+     * returns whether submit() was called */
+    template <typename Submit>
+    bool draw(size_t id, Submit submit) {
+        Object& object = this->object(id);
+        if (object.occluded) {
+            ++this->m_current.culled;
+            return false;
+        }
+
+        if (object.current) {
+            glBeginConditionalRender(object.current, GL_QUERY_NO_WAIT);
+            submit();
+            glEndConditionalRender();
+            ++this->m_current.conditional;
+        } else {
+            submit();
+        }
+        return true;
+    };
+
+    /* queries in flight are deleted unread */
+    void destroy() {
+        if (!this->m_all.empty()) glDeleteQueries(GLsizei(this->m_all.size()), this->m_all.data());
+        if (this->m_program) glDeleteProgram(this->m_program);
+        if (this->m_vertexArray) glDeleteVertexArrays(1, &this->m_vertexArray);
+        this->m_program = this->m_vertexArray = 0;
+        this->m_all.clear();
+        this->m_free.clear();
+        this->m_objects.clear();
+    };
+
+public:
+    /* counts of the last finished frame */
+    const FrameStats& lastFrame() const {
+        return this->m_last;
+    };
+
+    /* nothing if occlusion was never used */
+    void report(std::ostream& out) const {
+        if (this->m_framesUsed == 0) return;
+
+        double frames = double(this->m_framesUsed);
+        out << "occlusion: " << this->m_total.tested / frames << " tested, " << this->m_total.culled / frames
+            << " culled, " << this->m_total.conditional / frames << " conditional per frame over "
+            << this->m_framesUsed << " frames; " << this->m_occludedResults << " of " << this->m_results
+            << " results occluded";
+        if (this->m_results > 0) {
+            out << ", latency " << double(this->m_totalLatencyFrames) / this->m_results << " frames / "
+                << std::chrono::duration<double, std::milli>(this->m_totalLatency).count() / this->m_results
+                << " ms avg, " << this->m_maxLatencyFrames << " frames / "
+                << std::chrono::duration<double, std::milli>(this->m_maxLatency).count() << " ms max";
+        }
+        out << std::endl;
+    };
+
+private:
+    Object& object(size_t id) {
+        if (id >= this->m_objects.size()) this->m_objects.resize(id + 1);
+        return this->m_objects[id];
+    };
+
+    GLuint query() {
+        if (this->m_free.empty()) {
+            GLuint queries[16];
+            glGenQueries(16, queries);
+            this->m_free.insert(this->m_free.end(), queries, queries + 16);
+            this->m_all.insert(this->m_all.end(), queries, queries + 16);
+        }
+        GLuint query = this->m_free.back();
+        this->m_free.pop_back();
+        return query;
+    };
+
+    /* read finished queries in order; stop at the first one still in flight */
+    void collect(Object& object) {
+        while (!object.pending.empty()) {
+            const Pending& pending = object.pending.front();
+            GLint available = 0;
+            glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return;
+
+            GLuint passed = 0;
+            glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT, &passed);
+            object.occluded = passed == 0;
+
+            unsigned long latency_frames = this->m_frame - pending.frame;
+            Clock::duration latency = Clock::now() - pending.issued;
+            ++this->m_results;
+            if (object.occluded) ++this->m_occludedResults;
+            this->m_totalLatencyFrames += latency_frames;
+            this->m_maxLatencyFrames = std::max(this->m_maxLatencyFrames, latency_frames);
+            this->m_totalLatency += latency;
+            this->m_maxLatency = std::max(this->m_maxLatency, latency);
+
+            this->m_free.push_back(pending.query);
+            object.pending.pop_front();
+        }
+    };
+};
+
+
+#endif //_OCCLUSION_HPP
@@ -0,0 +1,97 @@
+#include "../myGL.hpp"
+#include "../Context.hpp"
+#include "../RenderThreads.hpp"
+#include "../VertexPulling.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+
+/* Constants. */
+static const GLint width = 400;
+static const GLint height = 400;
+
+/* the scenes of HelloGL & ColorAttribute; both pulled, so that contexts share nothing but shader files */
+struct Scene {
+    const char* name;
+    std::string vertex_shader_file;
+    std::string fragment_shader_file;
+    GLint angles;
+};
+
+static const Scene scenes[] = {
+        {"polygons", "polygon.vert", "solid_color.frag", 6},
+        {"colored triangles", "colored_polygon.vert", "smooth_color.frag", 3}
+};
+
+
+/* gl context drawing a grid of pulled polygons for a fixed number of frames */
+class Window : public GLContext {
+
+private:
+    const Scene& scene;
+    int frames_to_render;
+    int grid_side;
+    bool visible;
+
+    GLuint program_id; /* shaders */
+    PolygonPulling polygons;
+    int frames = 0;
+
+public:
+    Window(const Scene& scene, int frames_to_render, int grid_side, bool visible) :
+            scene(scene), frames_to_render(frames_to_render), grid_side(grid_side), visible(visible) {};
+
+    void setEnvironment() {
+        GLContext::setEnvironment();
+        glfwWindowHint(GLFW_VISIBLE, this->visible ? GL_TRUE : GL_FALSE);
+    };
+
+private:
+    void initialize() {
+        program_id = compileShaders(scene.vertex_shader_file, scene.fragment_shader_file);
+        polygons.initialize(program_id);
+    };
+
+    void draw() {
+        glClear(GL_COLOR_BUFFER_BIT);
+        polygons.draw(0.8f, scene.angles, grid_side);
+
+        if (++frames == frames_to_render) glfwSetWindowShouldClose(glfwGetCurrentContext(), GL_TRUE);
+    };
+
+    void destroy() {
+        glDeleteProgram(program_id);
+        polygons.destroy();
+    };
+};
+
+
+int main(int argc, char* argv[]) {
+    /* usage: Parallel [contexts] [frames] [grid side] [show]; e.g. one context per core to check that the aggregate
+     * fps scales. windows are hidden unless "show"; each renders frames frames of grid side^2 polygons uncapped.
+     * contexts alternate between the HelloGL and ColorAttribute scenes, re-implemented here as pulled polygons rather
+     * than by running those demos' own code; cvTexture is left out since its texture would need OpenCV per context */
+    int contexts = argc > 1 ? std::atoi(argv[1]) : int(std::max(std::thread::hardware_concurrency(), 1u));
+    int frames = argc > 2 ? std::atoi(argv[2]) : 600;
+    int grid_side = argc > 3 ? std::atoi(argv[3]) : 64;
+    bool visible = argc > 4 && std::string(argv[4]) == "show";
+
+    /* windows are created on the main thread; glfw is initialized by the first context */
+    std::vector<std::unique_ptr<Window>> windows;
+    RenderThreads threads;
+    for (int i = 0; i < contexts; ++i) {
+        const Scene& scene = scenes[i % 2];
+        windows.emplace_back(new Window(scene, frames, grid_side, visible));
+        windows.back()->framePacer().setBenchmarkMode(); // uncapped; throughput is what is measured
+        windows.back()->setAntiAliasMode(AntiAliasMode::none());
+        windows.back()->setEnvironment();
+        windows.back()->createWindow(width, height, std::string(scene.name) + " " + std::to_string(i));
+        threads.add(*windows.back());
+    }
+
+    threads.run(std::cout);
+
+    return EXIT_SUCCESS;
+}
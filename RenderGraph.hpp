@@ -0,0 +1,344 @@
+//
+// Created by pallas athena on 16/10/17.
+//
+
+#ifndef _RENDER_GRAPH_HPP
+#define _RENDER_GRAPH_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "myGL.hpp"
+#include "RenderTarget.hpp"
+#include "Timeline.hpp"
+
+
+/* a frame as passes declaring the targets they read & write, meant to be run from GLContext::draw(). compile() once
+ * after declaring everything: passes contributing to no output are culled, the rest keep their declaration order,
+ * which is the order reads see writes in. transient targets that are not alive at the same time and share a
+ * description are aliased onto one render target of the manager, and their attachments are invalidated before the
+ * first write and after the last read, so their contents are never stored or loaded where the driver can avoid it
+ * (glInvalidateFramebuffer, GL 4.3+). a transient target is undefined until its first pass writes it. gl calls
+ * require the owning context to be current. */
+class RenderGraph {
+public:
+    typedef size_t Resource;
+    typedef size_t Pass;
+    typedef std::function<void(RenderGraph&)> Execute;
+
+    static const size_t NONE = size_t(-1);
+
+private:
+    struct ResourceNode {
+        std::string name;
+        RenderTargetDescription description;
+        bool imported; // the framebuffer bound when execute() starts
+        bool output; // kept after the frame; neither aliased nor invalidated
+        size_t first; // lifetime as positions in the execution order; NONE if unused
+        size_t last;
+        size_t slot; // render target id in the manager
+    };
+
+    struct PassNode {
+        std::string name;
+        Execute execute;
+        std::vector<Resource> reads;
+        std::vector<Resource> writes;
+        bool sideEffects; // kept even if nothing reads its writes
+        bool live;
+    };
+
+    RenderTargetManager& m_targets;
+    std::vector<ResourceNode> m_resources;
+    std::vector<PassNode> m_passes;
+
+    /* compiled */
+    bool m_compiled = false;
+    std::vector<Pass> m_order; // live passes in execution order
+    std::vector<std::vector<Resource>> m_invalidateBefore; // per position in m_order; lifetimes starting there
+    std::vector<std::vector<Resource>> m_invalidateAfter; // lifetimes ending there
+    std::vector<RenderTargetDescription> m_slots; // descriptions of the manager targets created for the graph
+    std::vector<size_t> m_slotTargets; // their ids in the manager
+    bool m_invalidateSupported = false;
+
+    /* the imported framebuffer & viewport, captured by execute() */
+    GLint m_framebuffer = 0;
+    GLint m_viewport[4] = {0, 0, 0, 0};
+
+    unsigned long m_frames = 0;
+    unsigned long m_invalidations = 0;
+
+public:
+    RenderGraph(RenderTargetManager& targets) : m_targets(targets) {};
+
+    ~RenderGraph(){};
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+public:
+    /* transient target sized by the framebuffer; output ones keep their contents after the frame */
+    Resource createTarget(const std::string& name, const RenderTargetDescription& description, bool output = false) {
+        assert(!this->m_compiled);
+        this->m_resources.push_back(ResourceNode{name, description, false, output, NONE, NONE, NONE});
+        return this->m_resources.size() - 1;
+    };
+
+    /* whatever framebuffer is bound when execute() starts, e.g. the window or an anti-aliasing target */
+    Resource importFramebuffer(const std::string& name) {
+        assert(!this->m_compiled);
+        RenderTargetDescription none = {0, 0, 0, 1.0f};
+        this->m_resources.push_back(ResourceNode{name, none, true, true, NONE, NONE, NONE});
+        return this->m_resources.size() - 1;
+    };
+
+    Pass addPass(const std::string& name, Execute execute, bool side_effects = false) {
+        assert(!this->m_compiled);
+        this->m_passes.push_back(PassNode{name, execute, {}, {}, side_effects, false});
+        return this->m_passes.size() - 1;
+    };
+
+    void read(Pass pass, Resource resource) {
+        assert(!this->m_compiled);
+        this->m_passes[pass].reads.push_back(resource);
+    };
+
+    void write(Pass pass, Resource resource) {
+        assert(!this->m_compiled);
+        this->m_passes[pass].writes.push_back(resource);
+    };
+
+    /* cull, order, compute lifetimes & alias; registers the physical targets with the manager */
+    void compile() {
+        assert(!this->m_compiled);
+        this->cull();
+
+        for (Pass pass = 0; pass < this->m_passes.size(); ++pass) {
+            if (this->m_passes[pass].live) this->m_order.push_back(pass);
+        }
+        this->m_invalidateBefore.resize(this->m_order.size());
+        this->m_invalidateAfter.resize(this->m_order.size());
+
+        /* lifetimes; a transient target must be written before it is read */
+        for (size_t position = 0; position < this->m_order.size(); ++position) {
+            const PassNode& pass = this->m_passes[this->m_order[position]];
+            for (Resource resource : pass.reads) {
+                ResourceNode& node = this->m_resources[resource];
+                if (node.first == NONE && !node.imported) {
+                    std::cerr << "Render pass " + pass.name + " reads " + node.name + " before any pass writes it"
+                              << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                node.last = position;
+            }
+            for (Resource resource : pass.writes) {
+                ResourceNode& node = this->m_resources[resource];
+                if (node.first == NONE) node.first = position;
+                node.last = position;
+            }
+        }
+
+        this->alias();
+
+#ifdef GL_VERSION_4_3
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        this->m_invalidateSupported = major > 4 || (major == 4 && minor >= 3);
+#endif
+        this->m_compiled = true;
+    };
+
+    /* run the live passes into the framebuffer bound now; rebinds it with its viewport at the end */
+    void execute() {
+        assert(this->m_compiled);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &this->m_framebuffer);
+        glGetIntegerv(GL_VIEWPORT, this->m_viewport);
+
+        for (size_t position = 0; position < this->m_order.size(); ++position) {
+            PassNode& pass = this->m_passes[this->m_order[position]];
+            timeline::Zone zone("render pass", pass.name);
+
+            for (Resource resource : this->m_invalidateBefore[position]) this->invalidate(resource);
+            pass.execute(*this);
+            for (Resource resource : this->m_invalidateAfter[position]) this->invalidate(resource);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, GLuint(this->m_framebuffer));
+        glViewport(this->m_viewport[0], this->m_viewport[1], this->m_viewport[2], this->m_viewport[3]);
+        ++this->m_frames;
+    };
+
+public:
+    /* within a pass: bind as draw framebuffer with the viewport to render with */
+    void bind(Resource resource) {
+        const ResourceNode& node = this->m_resources[resource];
+        if (node.imported) {
+            glBindFramebuffer(GL_FRAMEBUFFER, GLuint(this->m_framebuffer));
+            glViewport(this->m_viewport[0], this->m_viewport[1], this->m_viewport[2], this->m_viewport[3]);
+        } else {
+            this->m_targets.bind(node.slot);
+        }
+    };
+
+    /* within a pass: storage of a transient target, e.g. to sample its color texture */
+    const RenderTarget& target(Resource resource) {
+        assert(!this->m_resources[resource].imported);
+        return this->m_targets.acquire(this->m_resources[resource].slot);
+    };
+
+public:
+    size_t livePasses() const {
+        return this->m_order.size();
+    };
+
+    /* render target memory at the current framebuffer size: one target per transient resource, the aliased targets
+     * actually created, and the most alive at once, which no aliasing can go below */
+    void report(std::ostream& out) const {
+        if (!this->m_compiled) return;
+
+        size_t unaliased = 0, aliased = 0, peak_alive = 0, transient = 0;
+        for (const ResourceNode& node : this->m_resources) {
+            if (node.imported || node.first == NONE) continue;
+            unaliased += this->bytes(node.description);
+            ++transient;
+        }
+        for (const RenderTargetDescription& description : this->m_slots) aliased += this->bytes(description);
+        for (size_t position = 0; position < this->m_order.size(); ++position) {
+            size_t alive = 0;
+            for (const ResourceNode& node : this->m_resources) {
+                if (node.imported || node.first == NONE) continue;
+                bool alive_here = node.output || (node.first <= position && position <= node.last);
+                if (alive_here) alive += this->bytes(node.description);
+            }
+            peak_alive = std::max(peak_alive, alive);
+        }
+
+        out << "render graph: " << this->m_order.size() << " of " << this->m_passes.size() << " passes live, "
+            << transient << " transient targets in " << this->m_slots.size() << "; at " << this->m_targets.width()
+            << "x" << this->m_targets.height() << " " << unaliased / 1e6 << " MB unaliased, " << aliased / 1e6
+            << " MB aliased, " << peak_alive / 1e6 << " MB alive at most; " << this->m_invalidations
+            << " invalidations over " << this->m_frames << " frames"
+            << (this->m_invalidateSupported ? "" : " (glInvalidateFramebuffer unsupported)") << std::endl;
+    };
+
+private:
+    /* live: passes with side effects or writing an imported or output target, and every earlier writer of what a
+     * live pass reads */
+    void cull() {
+        std::vector<Pass> work;
+        for (Pass pass = 0; pass < this->m_passes.size(); ++pass) {
+            PassNode& node = this->m_passes[pass];
+            node.live = node.sideEffects;
+            for (Resource resource : node.writes) {
+                if (this->m_resources[resource].output) node.live = true;
+            }
+            if (node.live) work.push_back(pass);
+        }
+
+        while (!work.empty()) {
+            Pass pass = work.back();
+            work.pop_back();
+            for (Resource resource : this->m_passes[pass].reads) {
+                for (Pass writer = 0; writer < pass; ++writer) {
+                    PassNode& node = this->m_passes[writer];
+                    if (node.live || std::find(node.writes.begin(), node.writes.end(), resource) == node.writes.end())
+                        continue;
+                    node.live = true;
+                    work.push_back(writer);
+                }
+            }
+        }
+    };
+
+    static bool sameDescription(const RenderTargetDescription& a, const RenderTargetDescription& b) {
+        return a.colorFormat == b.colorFormat && a.depthFormat == b.depthFormat && a.samples == b.samples &&
+               a.scale == b.scale;
+    };
+
+    /* greedy interval assignment in order of first use: reuse the first compatible target free by then */
+    void alias() {
+        std::vector<Resource> transient;
+        for (Resource resource = 0; resource < this->m_resources.size(); ++resource) {
+            const ResourceNode& node = this->m_resources[resource];
+            if (!node.imported && node.first != NONE) transient.push_back(resource);
+        }
+        std::stable_sort(transient.begin(), transient.end(), [this](Resource a, Resource b) {
+            return this->m_resources[a].first < this->m_resources[b].first;
+        });
+
+        std::vector<size_t> slot_last; // last position each slot is busy at; NONE when never free again
+        for (Resource resource : transient) {
+            ResourceNode& node = this->m_resources[resource];
+            size_t slot = NONE;
+            for (size_t i = 0; i < this->m_slots.size() && !node.output; ++i) {
+                if (slot_last[i] != NONE && slot_last[i] < node.first &&
+                    sameDescription(this->m_slots[i], node.description)) {
+                    slot = i;
+                    break;
+                }
+            }
+            if (slot == NONE) {
+                slot = this->m_slots.size();
+                this->m_slots.push_back(node.description);
+                this->m_slotTargets.push_back(this->m_targets.create(node.description));
+                slot_last.push_back(0);
+            }
+            slot_last[slot] = node.output ? NONE : node.last;
+            node.slot = this->m_slotTargets[slot];
+
+            if (!node.output) {
+                this->m_invalidateBefore[node.first].push_back(resource);
+                this->m_invalidateAfter[node.last].push_back(resource);
+            }
+        }
+    };
+
+    void invalidate(Resource resource) {
+#ifdef GL_VERSION_4_3
+        if (!this->m_invalidateSupported) return;
+        const ResourceNode& node = this->m_resources[resource];
+        GLenum attachments[2];
+        GLsizei count = 0;
+        if (node.description.colorFormat != 0) attachments[count++] = GL_COLOR_ATTACHMENT0;
+        if (node.description.depthFormat != 0) {
+            attachments[count++] = node.description.depthFormat == GL_DEPTH24_STENCIL8 ||
+                                   node.description.depthFormat == GL_DEPTH32F_STENCIL8 ?
+                                   GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, this->m_targets.acquire(node.slot).framebuffer);
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, count, attachments);
+        ++this->m_invalidations;
+#else
+        (void)resource;
+#endif
+    };
+
+    /* storage of a target at the current framebuffer size, rounded up as the manager allocates it */
+    size_t bytes(const RenderTargetDescription& description) const {
+        GLsizei width = GLsizei(std::max(1L, std::lround(this->m_targets.width() * description.scale)));
+        GLsizei height = GLsizei(std::max(1L, std::lround(this->m_targets.height() * description.scale)));
+        size_t allocated = size_t(RenderTargetManager::roundUp(width)) * size_t(RenderTargetManager::roundUp(height));
+        size_t samples = size_t(std::max(description.samples, 1));
+        return allocated * samples * (formatBytes(description.colorFormat) + formatBytes(description.depthFormat));
+    };
+
+    static size_t formatBytes(GLenum format) {
+        switch (format) {
+            case 0: return 0;
+            case GL_R8: return 1;
+            case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+            case GL_RGB8: return 3;
+            case GL_RGBA16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8: return 8;
+            case GL_RGBA32F: return 16;
+            default: return 4; // rgba8, r11f_g11f_b10f, depth24_stencil8, ...
+        }
+    };
+};
+
+
+#endif //_RENDER_GRAPH_HPP
@@ -0,0 +1,212 @@
+//
+// Created by pallas athena on 16/9/20.
+//
+
+#ifndef _RENDER_TARGET_HPP
+#define _RENDER_TARGET_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "myGL.hpp"
+
+
+/* what a size-dependent offscreen target consists of; 0 formats mean no such attachment */
+struct RenderTargetDescription {
+    GLenum colorFormat; // e.g. GL_RGBA8; a texture when single-sampled so that later passes can sample it
+    GLenum depthFormat; // e.g. GL_DEPTH24_STENCIL8; always a renderbuffer
+    GLsizei samples;    // 0 for single-sampled
+    float scale;        // relative to the framebuffer size
+};
+
+/* framebuffer object with its attachments; storage may be larger than the logical size, see RenderTargetManager.
+ * passes sampling the color texture scale texture coordinates by width / allocatedWidth (height likewise). */
+struct RenderTarget {
+    RenderTargetDescription description;
+
+    GLuint framebuffer;
+    GLuint color; // texture or renderbuffer name
+    GLuint depth; // renderbuffer name
+
+    GLsizei width; // logical size, the viewport to render with
+    GLsizei height;
+    GLsizei allocatedWidth; // storage size
+    GLsizei allocatedHeight;
+};
+
+
+/* owner of all framebuffer-size-dependent targets. resize() only records the new size; storage is reallocated lazily
+ * on the next use, rounded up to a granularity and kept while the size shrinks moderately, so that drag-resizing a
+ * window does not reallocate every frame. gl calls require the owning context to be current. */
+class RenderTargetManager {
+public:
+    static const GLsizei SIZE_GRANULARITY = 128; // storage sizes are multiples of this
+
+private:
+    std::vector<RenderTarget> m_targets;
+    GLsizei m_width = 0;
+    GLsizei m_height = 0;
+    unsigned long m_reallocations = 0;
+
+public:
+    /* storage size allocated for a logical size */
+    static GLsizei roundUp(GLsizei size) {
+        return (size + SIZE_GRANULARITY - 1) / SIZE_GRANULARITY * SIZE_GRANULARITY;
+    };
+
+private:
+
+    /* storage is reused while it covers the logical size and does not waste more than half in either dimension */
+    static bool fits(GLsizei allocated, GLsizei logical) {
+        return allocated >= logical && allocated <= 2 * roundUp(logical);
+    };
+
+    /* leaves the framebuffer, texture & renderbuffer bindings as they were, so that a lazy reallocation in the middle
+     * of a frame does not disturb the caller */
+    void allocate(RenderTarget& target) {
+        this->release(target);
+
+        // queried after the release; deleting a bound object has already reset its binding to 0
+        GLint draw_framebuffer, read_framebuffer, texture, renderbuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+        glGetIntegerv(GL_RENDERBUFFER_BINDING, &renderbuffer);
+
+        target.allocatedWidth = roundUp(target.width);
+        target.allocatedHeight = roundUp(target.height);
+        const RenderTargetDescription& description = target.description;
+
+        glGenFramebuffers(1, &target.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+
+        if (description.colorFormat != 0) {
+            if (description.samples == 0) {
+                glGenTextures(1, &target.color);
+                glBindTexture(GL_TEXTURE_2D, target.color);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexImage2D(GL_TEXTURE_2D, 0, description.colorFormat, target.allocatedWidth, target.allocatedHeight,
+                             0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.color, 0);
+            } else {
+                glGenRenderbuffers(1, &target.color);
+                glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+                glRenderbufferStorageMultisample(GL_RENDERBUFFER, description.samples, description.colorFormat,
+                                                 target.allocatedWidth, target.allocatedHeight);
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+            }
+        }
+
+        if (description.depthFormat != 0) {
+            GLenum attachment = description.depthFormat == GL_DEPTH24_STENCIL8 ||
+                                description.depthFormat == GL_DEPTH32F_STENCIL8 ?
+                                GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            glGenRenderbuffers(1, &target.depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, description.samples, description.depthFormat,
+                                             target.allocatedWidth, target.allocatedHeight);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, target.depth);
+        }
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Incomplete render target of " << target.allocatedWidth << "x" << target.allocatedHeight
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(draw_framebuffer));
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(read_framebuffer));
+        glBindTexture(GL_TEXTURE_2D, GLuint(texture));
+        glBindRenderbuffer(GL_RENDERBUFFER, GLuint(renderbuffer));
+
+        ++this->m_reallocations;
+    };
+
+    void release(RenderTarget& target) {
+        if (target.framebuffer != 0) glDeleteFramebuffers(1, &target.framebuffer);
+        if (target.color != 0) {
+            target.description.samples == 0 ? glDeleteTextures(1, &target.color) :
+                                              glDeleteRenderbuffers(1, &target.color);
+        }
+        if (target.depth != 0) glDeleteRenderbuffers(1, &target.depth);
+        target.framebuffer = target.color = target.depth = 0;
+        target.allocatedWidth = target.allocatedHeight = 0;
+    };
+
+public:
+    RenderTargetManager(){};
+
+    ~RenderTargetManager(){
+        // gl objects can only be deleted with a current context; destroy() is the caller's duty
+        assert(this->m_targets.empty());
+    };
+
+    RenderTargetManager(const RenderTargetManager&) = delete;
+    RenderTargetManager& operator=(const RenderTargetManager&) = delete;
+
+public:
+    /* register a target; storage is allocated on first use */
+    size_t create(const RenderTargetDescription& description) {
+        RenderTarget target = {description, 0, 0, 0, 0, 0, 0, 0};
+        this->m_targets.push_back(target);
+        return this->m_targets.size() - 1;
+    };
+
+    /* framebuffer size changed; nothing is reallocated here */
+    void resize(GLsizei width, GLsizei height) {
+        this->m_width = width;
+        this->m_height = height;
+    };
+
+    /* target with storage valid for the current size; bindings are left unchanged */
+    const RenderTarget& acquire(size_t id) {
+        RenderTarget& target = this->m_targets[id];
+        target.width = std::max(1, GLsizei(std::lround(this->m_width * target.description.scale)));
+        target.height = std::max(1, GLsizei(std::lround(this->m_height * target.description.scale)));
+
+        if (target.framebuffer == 0 ||
+            !fits(target.allocatedWidth, target.width) || !fits(target.allocatedHeight, target.height)) {
+            this->allocate(target);
+        }
+        return target;
+    };
+
+    /* bind as draw framebuffer with a viewport of its logical size */
+    const RenderTarget& bind(size_t id) {
+        const RenderTarget& target = this->acquire(id);
+        glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+        glViewport(0, 0, target.width, target.height);
+        return target;
+    };
+
+    /* delete all targets */
+    void destroy() {
+        for (RenderTarget& target : this->m_targets) this->release(target);
+        this->m_targets.clear();
+    };
+
+public:
+    /* framebuffer size last passed to resize() */
+    GLsizei width() const {
+        return this->m_width;
+    };
+
+    GLsizei height() const {
+        return this->m_height;
+    };
+
+    size_t targetsCount() const {
+        return this->m_targets.size();
+    };
+
+    unsigned long reallocations() const {
+        return this->m_reallocations;
+    };
+};
+
+
+#endif //_RENDER_TARGET_HPP
@@ -0,0 +1,101 @@
+//
+// Created by pallas athena on 16/10/14.
+//
+
+#ifndef _RENDER_THREADS_HPP
+#define _RENDER_THREADS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Context.hpp"
+
+
+/* several contexts rendering at once, one thread each, while the calling thread only pumps events: glfw allows
+ * event processing and window creation & destruction on the main thread alone, everything else of a frame runs on
+ * the context's own thread. windows are created beforehand on the main thread and destroyed by run(). reports of
+ * each context are buffered and written in order once every thread has finished, followed by the aggregate
+ * throughput. gl call tracing is not supported here; the recorder belongs to a single thread. */
+class RenderThreads {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    struct Job {
+        GLContext* context;
+        std::ostringstream report;
+        Clock::duration time = Clock::duration::zero(); // from run() to the end of its render loop
+    };
+
+    std::vector<std::unique_ptr<Job>> m_jobs;
+
+public:
+    RenderThreads(){};
+
+    ~RenderThreads(){};
+
+    RenderThreads(const RenderThreads&) = delete;
+    RenderThreads& operator=(const RenderThreads&) = delete;
+
+public:
+    /* context must have its window created and outlive run() */
+    void add(GLContext& context) {
+        this->m_jobs.emplace_back(new Job);
+        this->m_jobs.back()->context = &context;
+    };
+
+    /* main thread only; returns once every window should close */
+    void run(std::ostream& out) {
+        /* Timeline of every render thread & gpu into the file named by MYGL_TIMELINE_FILE */
+        const char* timeline_file = std::getenv("MYGL_TIMELINE_FILE");
+        if (timeline_file) timeline::enable();
+        timeline::setThreadName("events");
+
+        glfwMakeContextCurrent(nullptr); // each context is made current by its own thread
+
+        std::atomic<size_t> running(this->m_jobs.size());
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> threads;
+        for (const std::unique_ptr<Job>& job : this->m_jobs) {
+            Job* current = job.get();
+            threads.emplace_back([current, start, &running]() {
+                current->context->renderLoop(false, current->report);
+                current->time = Clock::now() - start;
+                running.fetch_sub(1);
+                glfwPostEmptyEvent(); // wake the event loop to notice
+            });
+        }
+
+        while (running.load() > 0) glfwWaitEvents();
+        for (std::thread& thread : threads) thread.join();
+        Clock::duration wall = Clock::now() - start;
+
+        unsigned long total_frames = 0;
+        for (const std::unique_ptr<Job>& job : this->m_jobs) {
+            job->context->destroyWindow();
+
+            unsigned long frames = job->context->framePacer().frames();
+            double seconds = std::chrono::duration<double>(job->time).count();
+            total_frames += frames;
+            out << job->context->windowTitle() << ": " << frames << " frames in " << seconds << " s, "
+                << (seconds > 0.0 ? frames / seconds : 0.0) << " fps" << std::endl
+                << job->report.str();
+        }
+
+        double seconds = std::chrono::duration<double>(wall).count();
+        out << this->m_jobs.size() << " contexts on " << std::thread::hardware_concurrency() << " hardware threads: "
+            << total_frames << " frames in " << seconds << " s, " << (seconds > 0.0 ? total_frames / seconds : 0.0)
+            << " fps aggregate" << std::endl;
+
+        if (timeline_file) timeline::writeChromeJson(timeline_file);
+    };
+};
+
+
+#endif //_RENDER_THREADS_HPP
@@ -0,0 +1,438 @@
+#include "../myGL.hpp"
+#include "../Context.hpp"
+#include "../Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <unordered_map>
+
+
+/* Constants. */
+static const GLint width = 600;
+static const GLint height = 600;
+
+
+/* gl context replaying a trace recorded with MYGL_TRACE: calls before the first frame marker in initialize(), one
+ * recorded frame per draw(), the rest in destroy(). object names & uniform locations are remapped to the ones this
+ * context hands out, so the workload is identical whatever the recording context returned. */
+class Window : public GLContext {
+
+private:
+    gltrace::TraceFile trace;
+    int loops; // times the recorded frames are played
+    bool visible;
+
+    size_t position = 0; // offset of the next record
+    size_t first_frame = 0; // offset of the first record after setup
+    size_t frames_end = 0; // offset of the first record after the last frame
+    int loop = 0;
+
+    /* recorded name -> replayed name */
+    std::unordered_map<GLuint, GLuint> buffers, vertex_arrays, textures, shaders, programs;
+    std::unordered_map<GLuint, GLuint> framebuffers, renderbuffers, queries;
+    std::unordered_map<uint64_t, GLint> uniform_locations; // (recorded program << 32 | recorded location)
+    GLuint current_program = 0; // recorded name
+    gltrace::UnpackState unpack; // as set by the replayed glPixelStorei calls
+
+    unsigned long calls = 0;
+    unsigned long frames = 0;
+    std::chrono::nanoseconds replay_time{0};
+
+public:
+    Window(const std::string& file, int loops, bool visible) : trace(file), loops(loops), visible(visible) {};
+
+    void setEnvironment() {
+        GLContext::setEnvironment();
+        glfwWindowHint(GLFW_VISIBLE, this->visible ? GL_TRUE : GL_FALSE);
+    };
+
+private:
+    void initialize() {
+        this->position = this->trace.begin();
+        this->replayUntilFrame();
+        this->first_frame = this->position;
+
+        /* what follows the last frame marker is teardown, left to destroy() */
+        size_t offset = this->position;
+        this->frames_end = this->position;
+        while (offset < this->trace.end()) {
+            if (this->trace.next(offset).op == gltrace::Op::Frame) this->frames_end = offset;
+        }
+    };
+
+    void draw() {
+        auto start = std::chrono::steady_clock::now();
+        bool frame = this->position < this->frames_end && this->replayUntilFrame();
+        this->replay_time += std::chrono::steady_clock::now() - start;
+        if (frame) ++this->frames;
+
+        /* end of the recorded frames; start over or stop */
+        if (this->position >= this->frames_end) {
+            if (frame && ++this->loop < this->loops) {
+                this->position = this->first_frame;
+            } else {
+                glfwSetWindowShouldClose(glfwGetCurrentContext(), GL_TRUE);
+            }
+        }
+    };
+
+    void destroy() {
+        /* teardown recorded after the last frame */
+        while (this->position < this->trace.end()) this->replay(this->trace.next(this->position));
+
+        std::cout << this->frames << " frames, " << this->calls << " calls replayed; "
+                  << std::chrono::duration<double, std::milli>(this->replay_time).count() / std::max(this->frames, 1ul)
+                  << " ms cpu submission per frame" << std::endl;
+        pacer.report(std::cout);
+    };
+
+private:
+    /* true when a frame marker ended the replayed calls, false when the trace ended first */
+    bool replayUntilFrame() {
+        while (this->position < this->trace.end()) {
+            gltrace::Record record = this->trace.next(this->position);
+            if (record.op == gltrace::Op::Frame) return true;
+            this->replay(record);
+        }
+        return false;
+    };
+
+    static GLuint lookup(const std::unordered_map<GLuint, GLuint>& names, uint64_t recorded) {
+        if (recorded == 0) return 0;
+        auto found = names.find(GLuint(recorded));
+        return found == names.end() ? GLuint(recorded) : found->second;
+    };
+
+    /* generate as many names as recorded and map them onto the recorded ones */
+    template <typename Generate>
+    static void generate(std::unordered_map<GLuint, GLuint>& names, const gltrace::Record& record, Generate gen) {
+        GLsizei n = GLsizei(record.args[0]);
+        std::vector<GLuint> created(n);
+        gen(n, created.data());
+        const GLuint* recorded = static_cast<const GLuint*>(record.blob);
+        for (GLsizei i = 0; i < n; ++i) names[recorded[i]] = created[i];
+    };
+
+    template <typename Delete>
+    static void remove(std::unordered_map<GLuint, GLuint>& names, const gltrace::Record& record, Delete del) {
+        GLsizei n = GLsizei(record.args[0]);
+        std::vector<GLuint> deleted(n);
+        const GLuint* recorded = static_cast<const GLuint*>(record.blob);
+        for (GLsizei i = 0; i < n; ++i) {
+            deleted[i] = lookup(names, recorded[i]);
+            names.erase(recorded[i]);
+        }
+        del(n, deleted.data());
+    };
+
+    GLint location(uint64_t recorded) const {
+        GLint recorded_location = GLint(int64_t(recorded));
+        if (recorded_location < 0) return -1;
+        auto found = this->uniform_locations.find(uint64_t(this->current_program) << 32 | GLuint(recorded_location));
+        return found == this->uniform_locations.end() ? recorded_location : found->second;
+    };
+
+    static const void* offset(uint64_t value) {
+        return reinterpret_cast<const void*>(uintptr_t(value));
+    };
+
+    void replay(const gltrace::Record& record) {
+        using gltrace::Op;
+        const uint64_t* a = record.args;
+        ++this->calls;
+
+        switch (record.op) {
+            case Op::GenBuffers:
+                generate(this->buffers, record, [](GLsizei n, GLuint* names) { glGenBuffers(n, names); });
+                break;
+            case Op::DeleteBuffers:
+                remove(this->buffers, record, [](GLsizei n, const GLuint* names) { glDeleteBuffers(n, names); });
+                break;
+            case Op::BindBuffer:
+                glBindBuffer(GLenum(a[0]), lookup(this->buffers, a[1]));
+                break;
+            case Op::BufferData:
+                glBufferData(GLenum(a[0]), GLsizeiptr(a[1]), a[3] ? record.blob : nullptr, GLenum(a[2]));
+                break;
+            case Op::BufferSubData:
+                glBufferSubData(GLenum(a[0]), GLintptr(a[1]), GLsizeiptr(a[2]), record.blob);
+                break;
+
+            case Op::GenVertexArrays:
+                generate(this->vertex_arrays, record, [](GLsizei n, GLuint* names) { glGenVertexArrays(n, names); });
+                break;
+            case Op::DeleteVertexArrays:
+                remove(this->vertex_arrays, record,
+                       [](GLsizei n, const GLuint* names) { glDeleteVertexArrays(n, names); });
+                break;
+            case Op::BindVertexArray:
+                glBindVertexArray(lookup(this->vertex_arrays, a[0]));
+                break;
+            case Op::EnableVertexAttribArray:
+                glEnableVertexAttribArray(GLuint(a[0]));
+                break;
+            case Op::VertexAttribPointer:
+                glVertexAttribPointer(GLuint(a[0]), GLint(a[1]), GLenum(a[2]), GLboolean(a[3]), GLsizei(a[4]),
+                                      offset(a[5]));
+                break;
+
+            case Op::GenTextures:
+                generate(this->textures, record, [](GLsizei n, GLuint* names) { glGenTextures(n, names); });
+                break;
+            case Op::DeleteTextures:
+                remove(this->textures, record, [](GLsizei n, const GLuint* names) { glDeleteTextures(n, names); });
+                break;
+            case Op::BindTexture:
+                glBindTexture(GLenum(a[0]), lookup(this->textures, a[1]));
+                break;
+            case Op::ActiveTexture:
+                glActiveTexture(GLenum(a[0]));
+                break;
+            case Op::TexParameteri:
+                glTexParameteri(GLenum(a[0]), GLenum(a[1]), GLint(a[2]));
+                break;
+            case Op::PixelStorei:
+                this->unpack.pixelStore(GLenum(a[0]), GLint(a[1]));
+                glPixelStorei(GLenum(a[0]), GLint(a[1]));
+                break;
+            case Op::TexImage2D:
+                this->trace.requirePixels(record, this->unpack);
+                glTexImage2D(GLenum(a[0]), GLint(a[1]), GLint(a[2]), GLsizei(a[3]), GLsizei(a[4]), GLint(a[5]),
+                             GLenum(a[6]), GLenum(a[7]), record.blobSize ? record.blob : nullptr);
+                break;
+            case Op::TexSubImage2D:
+                this->trace.requirePixels(record, this->unpack);
+                glTexSubImage2D(GLenum(a[0]), GLint(a[1]), GLint(a[2]), GLint(a[3]), GLsizei(a[4]), GLsizei(a[5]),
+                                GLenum(a[6]), GLenum(a[7]), record.blob);
+                break;
+
+            case Op::CreateShader:
+                this->shaders[GLuint(a[1])] = glCreateShader(GLenum(a[0]));
+                break;
+            case Op::ShaderSource: {
+                const GLchar* source = static_cast<const GLchar*>(record.blob);
+                GLint length = GLint(record.blobSize);
+                glShaderSource(lookup(this->shaders, a[0]), 1, &source, &length);
+                break;
+            }
+            case Op::CompileShader:
+                glCompileShader(lookup(this->shaders, a[0]));
+                break;
+            case Op::DeleteShader:
+                glDeleteShader(lookup(this->shaders, a[0]));
+                this->shaders.erase(GLuint(a[0]));
+                break;
+            case Op::CreateProgram:
+                this->programs[GLuint(a[0])] = glCreateProgram();
+                break;
+            case Op::AttachShader:
+                glAttachShader(lookup(this->programs, a[0]), lookup(this->shaders, a[1]));
+                break;
+            case Op::DetachShader:
+                glDetachShader(lookup(this->programs, a[0]), lookup(this->shaders, a[1]));
+                break;
+            case Op::LinkProgram:
+                glLinkProgram(lookup(this->programs, a[0]));
+                break;
+            case Op::DeleteProgram:
+                glDeleteProgram(lookup(this->programs, a[0]));
+                this->programs.erase(GLuint(a[0]));
+                break;
+            case Op::UseProgram:
+                this->current_program = GLuint(a[0]);
+                glUseProgram(lookup(this->programs, a[0]));
+                break;
+            case Op::GetUniformLocation: {
+                GLint recorded = GLint(int64_t(a[1]));
+                if (recorded < 0) break;
+                std::string name(static_cast<const char*>(record.blob), record.blobSize);
+                this->uniform_locations[a[0] << 32 | GLuint(recorded)] =
+                        glGetUniformLocation(lookup(this->programs, a[0]), name.c_str());
+                break;
+            }
+            case Op::Uniform1i:
+                glUniform1i(this->location(a[0]), GLint(int64_t(a[1])));
+                break;
+            case Op::Uniform1f:
+                glUniform1f(this->location(a[0]), gltrace::bitsFloat(a[1]));
+                break;
+            case Op::Uniform2f:
+                glUniform2f(this->location(a[0]), gltrace::bitsFloat(a[1]), gltrace::bitsFloat(a[2]));
+                break;
+
+            case Op::ClearColor:
+                glClearColor(gltrace::bitsFloat(a[0]), gltrace::bitsFloat(a[1]), gltrace::bitsFloat(a[2]),
+                             gltrace::bitsFloat(a[3]));
+                break;
+            case Op::Clear:
+                glClear(GLbitfield(a[0]));
+                break;
+            case Op::Viewport:
+                glViewport(GLint(int64_t(a[0])), GLint(int64_t(a[1])), GLsizei(a[2]), GLsizei(a[3]));
+                break;
+            case Op::Enable:
+                glEnable(GLenum(a[0]));
+                break;
+            case Op::Disable:
+                glDisable(GLenum(a[0]));
+                break;
+
+            case Op::DrawArrays:
+                glDrawArrays(GLenum(a[0]), GLint(a[1]), GLsizei(a[2]));
+                break;
+            case Op::DrawArraysInstanced:
+                glDrawArraysInstanced(GLenum(a[0]), GLint(a[1]), GLsizei(a[2]), GLsizei(a[3]));
+                break;
+            case Op::DrawElements:
+                glDrawElements(GLenum(a[0]), GLsizei(a[1]), GLenum(a[2]), offset(a[3]));
+                break;
+            case Op::DrawElementsBaseVertex:
+                glDrawElementsBaseVertex(GLenum(a[0]), GLsizei(a[1]), GLenum(a[2]), offset(a[3]),
+                                         GLint(int64_t(a[4])));
+                break;
+
+            case Op::DrawElementsInstancedBaseVertex:
+                glDrawElementsInstancedBaseVertex(GLenum(a[0]), GLsizei(a[1]), GLenum(a[2]), offset(a[3]),
+                                                  GLsizei(a[4]), GLint(int64_t(a[5])));
+                break;
+            case Op::MultiDrawElementsBaseVertex: {
+                GLsizei draws = GLsizei(a[2]);
+                const uint64_t* offsets = static_cast<const uint64_t*>(record.blob);
+                const GLsizei* counts = reinterpret_cast<const GLsizei*>(offsets + draws);
+                const GLint* base_vertices = reinterpret_cast<const GLint*>(counts + draws);
+                std::vector<const void*> indices(draws);
+                for (GLsizei i = 0; i < draws; ++i) indices[i] = offset(offsets[i]);
+                glMultiDrawElementsBaseVertex(GLenum(a[0]), counts, GLenum(a[1]), indices.data(), draws,
+                                              base_vertices);
+                break;
+            }
+#ifdef GL_VERSION_4_0
+            case Op::DrawArraysIndirect:
+                glDrawArraysIndirect(GLenum(a[0]), offset(a[1]));
+                break;
+            case Op::DrawElementsIndirect:
+                glDrawElementsIndirect(GLenum(a[0]), GLenum(a[1]), offset(a[2]));
+                break;
+#endif
+#ifdef GL_VERSION_4_3
+            case Op::MultiDrawArraysIndirect:
+                glMultiDrawArraysIndirect(GLenum(a[0]), offset(a[1]), GLsizei(a[2]), GLsizei(a[3]));
+                break;
+            case Op::MultiDrawElementsIndirect:
+                glMultiDrawElementsIndirect(GLenum(a[0]), GLenum(a[1]), offset(a[2]), GLsizei(a[3]), GLsizei(a[4]));
+                break;
+#endif
+
+            case Op::GenFramebuffers:
+                generate(this->framebuffers, record, [](GLsizei n, GLuint* names) { glGenFramebuffers(n, names); });
+                break;
+            case Op::DeleteFramebuffers:
+                remove(this->framebuffers, record,
+                       [](GLsizei n, const GLuint* names) { glDeleteFramebuffers(n, names); });
+                break;
+            case Op::BindFramebuffer:
+                glBindFramebuffer(GLenum(a[0]), lookup(this->framebuffers, a[1]));
+                break;
+            case Op::FramebufferTexture2D:
+                glFramebufferTexture2D(GLenum(a[0]), GLenum(a[1]), GLenum(a[2]), lookup(this->textures, a[3]),
+                                       GLint(a[4]));
+                break;
+            case Op::FramebufferRenderbuffer:
+                glFramebufferRenderbuffer(GLenum(a[0]), GLenum(a[1]), GLenum(a[2]), lookup(this->renderbuffers, a[3]));
+                break;
+            case Op::GenRenderbuffers:
+                generate(this->renderbuffers, record, [](GLsizei n, GLuint* names) { glGenRenderbuffers(n, names); });
+                break;
+            case Op::DeleteRenderbuffers:
+                remove(this->renderbuffers, record,
+                       [](GLsizei n, const GLuint* names) { glDeleteRenderbuffers(n, names); });
+                break;
+            case Op::BindRenderbuffer:
+                glBindRenderbuffer(GLenum(a[0]), lookup(this->renderbuffers, a[1]));
+                break;
+            case Op::RenderbufferStorageMultisample:
+                glRenderbufferStorageMultisample(GLenum(a[0]), GLsizei(a[1]), GLenum(a[2]), GLsizei(a[3]),
+                                                 GLsizei(a[4]));
+                break;
+            case Op::BlitFramebuffer:
+                glBlitFramebuffer(GLint(int64_t(a[0])), GLint(int64_t(a[1])), GLint(int64_t(a[2])),
+                                  GLint(int64_t(a[3])), GLint(int64_t(a[4])), GLint(int64_t(a[5])),
+                                  GLint(int64_t(a[6])), GLint(int64_t(a[7])), GLbitfield(a[8]), GLenum(a[9]));
+                break;
+#ifdef GL_VERSION_4_3
+            case Op::InvalidateFramebuffer:
+                glInvalidateFramebuffer(GLenum(a[0]), GLsizei(a[1]), static_cast<const GLenum*>(record.blob));
+                break;
+#endif
+            case Op::DepthMask:
+                glDepthMask(GLboolean(a[0]));
+                break;
+            case Op::ColorMask:
+                glColorMask(GLboolean(a[0]), GLboolean(a[1]), GLboolean(a[2]), GLboolean(a[3]));
+                break;
+            case Op::Uniform3fv:
+                glUniform3fv(this->location(a[0]), GLsizei(a[1]), static_cast<const GLfloat*>(record.blob));
+                break;
+            case Op::UniformMatrix4fv:
+                glUniformMatrix4fv(this->location(a[0]), GLsizei(a[1]), GLboolean(a[2]),
+                                   static_cast<const GLfloat*>(record.blob));
+                break;
+
+            case Op::GenQueries:
+                generate(this->queries, record, [](GLsizei n, GLuint* names) { glGenQueries(n, names); });
+                break;
+            case Op::DeleteQueries:
+                remove(this->queries, record, [](GLsizei n, const GLuint* names) { glDeleteQueries(n, names); });
+                break;
+            case Op::BeginQuery:
+                glBeginQuery(GLenum(a[0]), lookup(this->queries, a[1]));
+                break;
+            case Op::EndQuery:
+                glEndQuery(GLenum(a[0]));
+                break;
+            case Op::QueryCounter:
+                glQueryCounter(lookup(this->queries, a[0]), GLenum(a[1]));
+                break;
+            case Op::BeginConditionalRender:
+                glBeginConditionalRender(lookup(this->queries, a[0]), GLenum(a[1]));
+                break;
+            case Op::EndConditionalRender:
+                glEndConditionalRender();
+                break;
+
+            default:
+                std::cerr << "Unknown trace record " << unsigned(record.op) << std::endl;
+                exit(EXIT_FAILURE);
+        }
+    };
+};
+
+
+int main(int argc, char* argv[]) {
+    /* usage: Replay trace-file [loops] [fps] [show]; record a trace by building a demo with -DMYGL_TRACE and running
+     * it with MYGL_TRACE_FILE=file. frames are played as fast as possible unless fps is given and greater than 0; the
+     * window stays hidden unless the fourth argument is "show" */
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " trace-file [loops] [fps] [show]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    int loops = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 1;
+    double fps = argc > 3 ? std::atof(argv[3]) : 0.0;
+    bool visible = argc > 4 && std::string(argv[4]) == "show";
+
+    Window w(argv[1], loops, visible);
+    if (fps > 0.0) {
+        w.framePacer().setSwapInterval(0);
+        w.framePacer().setTargetFps(fps);
+    } else {
+        w.framePacer().setBenchmarkMode();
+    }
+    w.setAntiAliasMode(AntiAliasMode::none()); // the recorded frames carry their own state; no extra passes
+    w.setEnvironment();
+    w.createWindow(width, height, "Replay");
+
+    w.mainloop();
+
+    return EXIT_SUCCESS;
+}
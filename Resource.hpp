@@ -0,0 +1,319 @@
+//
+// Created by pallas athena on 16/9/12.
+//
+
+#ifndef _RESOURCE_HPP
+#define _RESOURCE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "myGL.hpp"
+
+
+/* categories of gpu memory accounted by the resource pool */
+enum class ResourceCategory : int {
+    Vertex = 0,
+    Index,
+    Texture,
+    Uniform,
+    Count
+};
+
+
+/* byte counters per category; "allocated" includes objects parked in the pool, "in use" does not */
+class ResourceStatistics {
+public:
+    static const int categories = static_cast<int>(ResourceCategory::Count);
+
+private:
+    GLsizeiptr m_allocated[categories] = {0};
+    GLsizeiptr m_inUse[categories] = {0};
+    GLsizeiptr m_allocatedPeak[categories] = {0};
+    GLsizeiptr m_inUsePeak[categories] = {0};
+    GLsizeiptr m_totalAllocatedPeak = 0;
+
+    size_t m_created = 0;  // gl objects actually generated
+    size_t m_recycled = 0; // acquisitions served from the pool
+
+public:
+    void allocate(ResourceCategory category, GLsizeiptr bytes) {
+        int i = static_cast<int>(category);
+        this->m_allocated[i] += bytes;
+        this->m_allocatedPeak[i] = std::max(this->m_allocatedPeak[i], this->m_allocated[i]);
+        this->m_totalAllocatedPeak = std::max(this->m_totalAllocatedPeak, this->totalAllocated());
+        ++this->m_created;
+    };
+
+    void free(ResourceCategory category, GLsizeiptr bytes) {
+        this->m_allocated[static_cast<int>(category)] -= bytes;
+    };
+
+    void acquire(ResourceCategory category, GLsizeiptr bytes, bool recycled) {
+        int i = static_cast<int>(category);
+        this->m_inUse[i] += bytes;
+        this->m_inUsePeak[i] = std::max(this->m_inUsePeak[i], this->m_inUse[i]);
+        if (recycled) ++this->m_recycled;
+    };
+
+    void release(ResourceCategory category, GLsizeiptr bytes) {
+        this->m_inUse[static_cast<int>(category)] -= bytes;
+    };
+
+public:
+    GLsizeiptr allocated(ResourceCategory category) const {
+        return this->m_allocated[static_cast<int>(category)];
+    };
+
+    GLsizeiptr inUse(ResourceCategory category) const {
+        return this->m_inUse[static_cast<int>(category)];
+    };
+
+    GLsizeiptr allocatedPeak(ResourceCategory category) const {
+        return this->m_allocatedPeak[static_cast<int>(category)];
+    };
+
+    GLsizeiptr inUsePeak(ResourceCategory category) const {
+        return this->m_inUsePeak[static_cast<int>(category)];
+    };
+
+    GLsizeiptr totalAllocated() const {
+        GLsizeiptr total = 0;
+        for (int i = 0; i < categories; ++i) total += this->m_allocated[i];
+        return total;
+    };
+
+    GLsizeiptr totalAllocatedPeak() const {
+        return this->m_totalAllocatedPeak;
+    };
+
+    size_t objectsCreated() const {
+        return this->m_created;
+    };
+
+    size_t objectsRecycled() const {
+        return this->m_recycled;
+    };
+
+    void report(std::ostream& out) const {
+        static const char* names[categories] = {"vertex", "index", "texture", "uniform"};
+        for (int i = 0; i < categories; ++i) {
+            out << names[i] << ": " << this->m_inUse[i] << " in use (peak " << this->m_inUsePeak[i] << "), "
+                << this->m_allocated[i] << " allocated (peak " << this->m_allocatedPeak[i] << ") bytes" << std::endl;
+        }
+        out << "total: " << this->totalAllocated() << " allocated (peak " << this->m_totalAllocatedPeak << ") bytes; "
+            << this->m_created << " objects created, " << this->m_recycled << " recycled" << std::endl;
+    };
+};
+
+
+/* buffer handed out by the pool; capacity is the size class, may exceed the requested size */
+struct PooledBuffer {
+    GLuint name;
+    GLsizeiptr size;
+    GLsizeiptr capacity;
+    GLenum usage;
+    ResourceCategory category;
+};
+
+/* 2d texture handed out by the pool; storage allocated but content undefined */
+struct PooledTexture {
+    GLuint name;
+    GLenum internalFormat;
+    GLsizei width;
+    GLsizei height;
+    GLsizeiptr bytes;
+};
+
+
+/* pool of gl buffer & texture names with storage bucketed by size class; released objects are recycled instead of
+ * deleted. all methods must be called with the owning context current, including clear() before the context is
+ * destroyed. */
+class ResourcePool {
+public:
+    static const GLsizeiptr MIN_BUFFER_CLASS = 256; // smallest buffer size class in bytes
+
+private:
+    typedef std::tuple<ResourceCategory, GLsizeiptr, GLenum> BufferKey; // category, size class, usage
+    typedef std::tuple<GLenum, GLsizei, GLsizei> TextureKey; // internal format, width, height
+
+    std::map<BufferKey, std::vector<PooledBuffer>> m_freeBuffers;
+    std::map<TextureKey, std::vector<PooledTexture>> m_freeTextures;
+
+    size_t m_liveBuffers = 0;
+    size_t m_liveTextures = 0;
+
+    ResourceStatistics m_statistics;
+
+public:
+    ResourcePool() {};
+
+    ~ResourcePool() {
+        // gl objects can only be deleted with a current context; clear() is the caller's duty
+        assert(this->m_freeBuffers.empty() && this->m_freeTextures.empty());
+    };
+
+    ResourcePool(const ResourcePool&) = delete;
+    ResourcePool& operator=(const ResourcePool&) = delete;
+
+public:
+    /* round up to the next power of two, no less than MIN_BUFFER_CLASS */
+    static GLsizeiptr sizeClass(GLsizeiptr size) {
+        GLsizeiptr size_class = MIN_BUFFER_CLASS;
+        while (size_class < size) size_class <<= 1;
+        return size_class;
+    };
+
+    /* bytes per texel of the storage of an internal format; the nominal size, drivers may pad e.g. GL_RGB8 to 4 */
+    static GLsizeiptr texelSize(GLenum internal_format) {
+        switch (internal_format) {
+            case GL_R8: case GL_RED: return 1;
+            case GL_RG8: case GL_RG: case GL_R16: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+            case GL_RGB8: case GL_SRGB8: case GL_RGB: case GL_DEPTH_COMPONENT24: return 3;
+            case GL_RGB16: case GL_RGB16F: return 6;
+            case GL_RGBA16: case GL_RGBA16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8: return 8;
+            case GL_RGB32F: return 12;
+            case GL_RGBA32F: return 16;
+            default: return 4; // rgba8, srgb8_alpha8, rgb10_a2, r11f_g11f_b10f, r32f, rg16f, depth24_stencil8, ...
+        }
+    };
+
+    /* get a buffer whose storage holds at least size bytes; data may be null to leave content undefined */
+    PooledBuffer acquireBuffer(ResourceCategory category, GLsizeiptr size, const void* data = nullptr,
+                               GLenum usage = GL_STATIC_DRAW) {
+        BufferKey key(category, sizeClass(size), usage);
+        PooledBuffer buffer;
+        bool recycled = false;
+        GLint bound; // put back below, like every other binding of the caller
+        glGetIntegerv(GL_COPY_WRITE_BUFFER_BINDING, &bound);
+
+        auto bucket = this->m_freeBuffers.find(key);
+        if (bucket != this->m_freeBuffers.end() && !bucket->second.empty()) {
+            buffer = bucket->second.back();
+            bucket->second.pop_back();
+            recycled = true;
+        } else {
+            buffer.capacity = std::get<1>(key);
+            buffer.usage = usage;
+            buffer.category = category;
+            glGenBuffers(1, &buffer.name);
+            // bind to the copy target so that array / element bindings of the caller are not disturbed
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.name);
+            glBufferData(GL_COPY_WRITE_BUFFER, buffer.capacity, nullptr, usage);
+            this->m_statistics.allocate(category, buffer.capacity);
+        }
+        buffer.size = size;
+
+        if (data) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.name);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, GLuint(bound));
+
+        this->m_statistics.acquire(category, buffer.capacity, recycled);
+        ++this->m_liveBuffers;
+        return buffer;
+    };
+
+    /* return a buffer to the pool; its name stays valid for reuse by later acquisitions */
+    void releaseBuffer(const PooledBuffer& buffer) {
+        this->m_freeBuffers[BufferKey(buffer.category, buffer.capacity, buffer.usage)].push_back(buffer);
+        this->m_statistics.release(buffer.category, buffer.capacity);
+        --this->m_liveBuffers;
+    };
+
+    /* get a 2d texture with allocated level 0 storage and the gl default sampling parameters, recycled or not;
+     * filtering is left to the caller. format & type only need to be compatible with internal_format, no pixels are
+     * read; storage is accounted by internal_format. the caller's GL_TEXTURE_2D binding is kept */
+    PooledTexture acquireTexture2D(GLenum internal_format, GLsizei width, GLsizei height,
+                                   GLenum format = GL_RGBA, GLenum type = GL_UNSIGNED_BYTE) {
+        TextureKey key(internal_format, width, height);
+        PooledTexture texture;
+        bool recycled = false;
+
+        auto bucket = this->m_freeTextures.find(key);
+        if (bucket != this->m_freeTextures.end() && !bucket->second.empty()) {
+            texture = bucket->second.back();
+            bucket->second.pop_back();
+            recycled = true;
+        } else {
+            texture.internalFormat = internal_format;
+            texture.width = width;
+            texture.height = height;
+            texture.bytes = texelSize(internal_format) * width * height;
+            GLint bound;
+            glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+            glGenTextures(1, &texture.name);
+            glBindTexture(GL_TEXTURE_2D, texture.name);
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, nullptr);
+            glBindTexture(GL_TEXTURE_2D, GLuint(bound));
+            this->m_statistics.allocate(ResourceCategory::Texture, texture.bytes);
+        }
+
+        this->m_statistics.acquire(ResourceCategory::Texture, texture.bytes, recycled);
+        ++this->m_liveTextures;
+        return texture;
+    };
+
+    /* return a texture to the pool; its sampling parameters are reset to the gl defaults so that the next user gets
+     * what a new texture has */
+    void releaseTexture(const PooledTexture& texture) {
+        GLint bound;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+        glBindTexture(GL_TEXTURE_2D, texture.name);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D, GLuint(bound));
+
+        this->m_freeTextures[TextureKey(texture.internalFormat, texture.width, texture.height)].push_back(texture);
+        this->m_statistics.release(ResourceCategory::Texture, texture.bytes);
+        --this->m_liveTextures;
+    };
+
+    /* delete every pooled (released) object; live objects are untouched */
+    void trim() {
+        for (auto& bucket : this->m_freeBuffers) {
+            for (auto& buffer : bucket.second) {
+                glDeleteBuffers(1, &buffer.name);
+                this->m_statistics.free(buffer.category, buffer.capacity);
+            }
+        }
+        this->m_freeBuffers.clear();
+
+        for (auto& bucket : this->m_freeTextures) {
+            for (auto& texture : bucket.second) {
+                glDeleteTextures(1, &texture.name);
+                this->m_statistics.free(ResourceCategory::Texture, texture.bytes);
+            }
+        }
+        this->m_freeTextures.clear();
+    };
+
+    /* delete pooled objects; every acquired object should have been released beforehand */
+    void clear() {
+        assert(this->m_liveBuffers == 0 && this->m_liveTextures == 0);
+        this->trim();
+    };
+
+public:
+    const ResourceStatistics& statistics() const {
+        return this->m_statistics;
+    };
+
+    size_t liveBuffers() const {
+        return this->m_liveBuffers;
+    };
+
+    size_t liveTextures() const {
+        return this->m_liveTextures;
+    };
+};
+
+
+#endif //_RESOURCE_HPP
@@ -0,0 +1,505 @@
+//
+// Created by pallas athena on 16/9/24.
+//
+
+#ifndef _SOFT_RASTER_HPP
+#define _SOFT_RASTER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+# include <emmintrin.h>
+# define SOFT_RASTER_SSE2
+#endif
+
+#include "myGL.hpp"
+
+
+/* pack normalized color channels into RGBA8, red in the lowest byte */
+inline uint32_t packRgba(float r, float g, float b, float a = 1.0f) {
+    auto channel = [](float c) { return uint32_t(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+};
+
+
+/* RGBA8 color buffer; rows bottom-up like an opengl framebuffer, padded to a multiple of 4 pixels */
+class SoftFramebuffer {
+public:
+    const int width;
+    const int height;
+    const int stride; // pixels per row
+    std::vector<uint32_t> pixels;
+
+public:
+    SoftFramebuffer(int width, int height) :
+            width(width), height(height), stride((width + 3) & ~3), pixels(size_t(stride) * height, 0) {};
+
+    ~SoftFramebuffer(){};
+
+public:
+    void clear(uint32_t rgba) {
+        std::fill(this->pixels.begin(), this->pixels.end(), rgba);
+    };
+
+    uint32_t pixel(int x, int y) const {
+        return this->pixels[size_t(y) * this->stride + x];
+    };
+
+    /* binary ppm, top row first */
+    bool writePpm(const std::string& file) const {
+        FILE* out = std::fopen(file.c_str(), "wb");
+        if (!out) return false;
+
+        std::fprintf(out, "P6\n%d %d\n255\n", this->width, this->height);
+        std::vector<unsigned char> row(size_t(this->width) * 3);
+        for (int y = this->height - 1; y >= 0; --y) {
+            for (int x = 0; x < this->width; ++x) {
+                uint32_t rgba = this->pixel(x, y);
+                row[3 * x] = (unsigned char)(rgba), row[3 * x + 1] = (unsigned char)(rgba >> 8);
+                row[3 * x + 2] = (unsigned char)(rgba >> 16);
+            }
+            std::fwrite(row.data(), 1, row.size(), out);
+        }
+
+        return std::fclose(out) == 0;
+    };
+
+    /* binary ppm as written by writePpm(); false if the file is missing or not of this size */
+    bool readPpm(const std::string& file) {
+        FILE* in = std::fopen(file.c_str(), "rb");
+        if (!in) return false;
+
+        int width = 0, height = 0, max = 0;
+        bool valid = std::fscanf(in, "P6 %d %d %d", &width, &height, &max) == 3 && std::fgetc(in) != EOF &&
+                     width == this->width && height == this->height && max == 255;
+        std::vector<unsigned char> row(size_t(this->width) * 3);
+        for (int y = this->height - 1; valid && y >= 0; --y) {
+            valid = std::fread(row.data(), 1, row.size(), in) == row.size();
+            for (int x = 0; valid && x < this->width; ++x) {
+                this->pixels[size_t(y) * this->stride + x] =
+                        uint32_t(row[3 * x]) | uint32_t(row[3 * x + 1]) << 8 | uint32_t(row[3 * x + 2]) << 16 |
+                        0xFF000000u;
+            }
+        }
+
+        std::fclose(in);
+        return valid;
+    };
+};
+
+
+/* RGBA8 texture sampled with GL_NEAREST & GL_REPEAT, as loadRgbTexture() configures it; rows bottom-up */
+class SoftTexture {
+public:
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> texels;
+
+public:
+    uint32_t sampleNearest(float u, float v) const {
+        int x = int((u - std::floor(u)) * this->width), y = int((v - std::floor(v)) * this->height);
+        return this->texels[size_t(std::min(y, this->height - 1)) * this->width + std::min(x, this->width - 1)];
+    };
+
+    static SoftTexture checkerboard(int size, int cells) {
+        SoftTexture texture;
+        texture.width = texture.height = size;
+        texture.texels.resize(size_t(size) * size);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                bool odd = ((x * cells / size) + (y * cells / size)) % 2 != 0;
+                texture.texels[size_t(y) * size + x] = odd ? packRgba(0.9f, 0.9f, 0.9f) : packRgba(0.2f, 0.2f, 0.2f);
+            }
+        }
+        return texture;
+    };
+
+#ifndef MYGL_NO_OPENCV
+    /* from the BGR bottom-up image of readRgbImage() */
+    static SoftTexture fromImage(const cv::Mat& image) {
+        assert(image.type() == CV_8UC3);
+        SoftTexture texture;
+        texture.width = image.cols;
+        texture.height = image.rows;
+        texture.texels.resize(size_t(image.cols) * image.rows);
+        for (int y = 0; y < image.rows; ++y) {
+            const unsigned char* bgr = image.ptr(y);
+            for (int x = 0; x < image.cols; ++x, bgr += 3) {
+                texture.texels[size_t(y) * image.cols + x] =
+                        uint32_t(bgr[2]) | uint32_t(bgr[1]) << 8 | uint32_t(bgr[0]) << 16 | 0xFF000000u;
+            }
+        }
+        return texture;
+    };
+#endif
+};
+
+
+/* where positions & the one shaded attribute live in a vertex buffer; both as GL_FLOAT, strides in bytes */
+struct SoftVertexStream {
+    const unsigned char* data;
+    GLsizei positionOffset;
+    GLsizei positionStride;
+    GLsizei attributeOffset;
+    GLsizei attributeStride;
+    GLint attributeDimension; // 0, 2 (texture coordinates) or 3 (color)
+};
+
+/* stream over a VertexBufferHeader; attribute_offset is e.g. header.colorDataOffset() */
+template <typename T> SoftVertexStream softVertexStream(const VertexBufferHeader<T>& header,
+                                                        const void* attribute_offset, GLint attribute_dim) {
+    static_assert(sizeof(T) == sizeof(GLfloat), "software rasterizer reads GL_FLOAT vertex data only");
+    return SoftVertexStream{
+            reinterpret_cast<const unsigned char*>(header.bufferData()),
+            GLsizei((GLintptr)header.positionDataOffset()), header.stride(),
+            GLsizei((GLintptr)attribute_offset), header.stride(), attribute_dim
+    };
+};
+
+
+/* how fragments get their color */
+enum class SoftShading {
+    Flat,    // one color for the whole draw, like solid_color.frag
+    Color,   // interpolated vertex color, like smooth_color.frag
+    Texture  // nearest-sampled texture, like texture.frag
+};
+
+
+/* four lanes of floats; SSE2 where available, plain arrays otherwise */
+#ifdef SOFT_RASTER_SSE2
+struct Float4 {
+    __m128 v;
+
+    static Float4 splat(float f) { return Float4{_mm_set1_ps(f)}; };
+    static Float4 ramp(float f) { return Float4{_mm_setr_ps(f, f + 1.0f, f + 2.0f, f + 3.0f)}; };
+    Float4 operator+(const Float4& o) const { return Float4{_mm_add_ps(this->v, o.v)}; };
+    Float4 operator*(const Float4& o) const { return Float4{_mm_mul_ps(this->v, o.v)}; };
+    void store(float* out) const { _mm_storeu_ps(out, this->v); };
+
+    /* bit i set where lane i of all three is positive, or zero for the edges whose bit is set in inclusive */
+    static int insideMask(const Float4& a, const Float4& b, const Float4& c, int inclusive) {
+        __m128 zero = _mm_setzero_ps();
+        auto inside = [zero](__m128 w, bool edge_inclusive) {
+            return edge_inclusive ? _mm_cmpge_ps(w, zero) : _mm_cmpgt_ps(w, zero);
+        };
+        return _mm_movemask_ps(_mm_and_ps(_mm_and_ps(inside(a.v, inclusive & 1), inside(b.v, inclusive & 2)),
+                                          inside(c.v, inclusive & 4)));
+    };
+};
+#else
+struct Float4 {
+    float v[4];
+
+    static Float4 splat(float f) { return Float4{{f, f, f, f}}; };
+    static Float4 ramp(float f) { return Float4{{f, f + 1.0f, f + 2.0f, f + 3.0f}}; };
+    Float4 operator+(const Float4& o) const {
+        return Float4{{v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3]}};
+    };
+    Float4 operator*(const Float4& o) const {
+        return Float4{{v[0] * o.v[0], v[1] * o.v[1], v[2] * o.v[2], v[3] * o.v[3]}};
+    };
+    void store(float* out) const { std::copy(v, v + 4, out); };
+
+    static int insideMask(const Float4& a, const Float4& b, const Float4& c, int inclusive) {
+        auto inside = [](float w, bool edge_inclusive) { return edge_inclusive ? w >= 0.0f : w > 0.0f; };
+        int mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            mask |= (inside(a.v[i], inclusive & 1) && inside(b.v[i], inclusive & 2) && inside(c.v[i], inclusive & 4))
+                    << i;
+        }
+        return mask;
+    };
+};
+#endif
+
+
+/* tile-based rasterizer for the 2d scenes of the demos: no depth test, no blending, no perspective, no culling.
+ * drawArrays() transforms & bins GL_TRIANGLES into 64x64 tiles; flush() shades the tiles on a pool of threads,
+ * preserving submission order within each tile. pixel centers exactly on an edge follow the top-left rule, so
+ * triangles sharing an edge cover each pixel along it once. */
+class SoftRasterizer {
+public:
+    static const int TILE_SIZE = 64;
+
+private:
+    struct Triangle {
+        float a[3], b[3], c[3]; // edge functions a * x + b * y + c, positive inside
+        int inclusive; // bit i set if edge i is a top or left edge, whose pixel centers are covered
+        float inverseArea;
+        float attribute[3], dAttribute1[3], dAttribute2[3]; // attribute = a0 + l1 * (a1 - a0) + l2 * (a2 - a0)
+        int minX, minY, maxX, maxY; // inclusive pixel bounds, clipped to the viewport
+        SoftShading shading;
+        uint32_t flatColor;
+        const SoftTexture* texture;
+    };
+
+    SoftFramebuffer* m_target = nullptr;
+    int m_viewport[4] = {0, 0, 0, 0};
+    int m_tilesX = 0;
+    int m_tilesY = 0;
+
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_bins; // triangle indices per tile
+
+    /* thread pool */
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    unsigned long m_generation = 0;
+    unsigned m_busy = 0;
+    bool m_quit = false;
+    std::atomic<size_t> m_nextTile;
+
+    /* statistics since construction */
+    unsigned long m_trianglesCount = 0;
+    std::atomic<unsigned long> m_pixelsCount;
+
+public:
+    /* threads includes the caller of flush() */
+    SoftRasterizer(unsigned threads = std::max(1u, std::thread::hardware_concurrency())) :
+            m_nextTile(0), m_pixelsCount(0) {
+        for (unsigned i = 1; i < threads; ++i) {
+            this->m_workers.emplace_back([this]() { this->workerLoop(); });
+        }
+    };
+
+    ~SoftRasterizer() {
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_quit = true;
+        }
+        this->m_wake.notify_all();
+        for (std::thread& worker : this->m_workers) worker.join();
+    };
+
+    SoftRasterizer(const SoftRasterizer&) = delete;
+    SoftRasterizer& operator=(const SoftRasterizer&) = delete;
+
+public:
+    /* start a frame into target with the viewport given like glViewport() */
+    void begin(SoftFramebuffer& target, int x, int y, int width, int height) {
+        this->m_target = &target;
+        this->m_viewport[0] = x, this->m_viewport[1] = y, this->m_viewport[2] = width, this->m_viewport[3] = height;
+        this->m_tilesX = (target.width + TILE_SIZE - 1) / TILE_SIZE;
+        this->m_tilesY = (target.height + TILE_SIZE - 1) / TILE_SIZE;
+
+        this->m_triangles.clear();
+        this->m_bins.resize(size_t(this->m_tilesX) * this->m_tilesY);
+        for (auto& bin : this->m_bins) bin.clear();
+    };
+
+    /* counterpart of glDrawArrays(GL_TRIANGLES, first, count) */
+    void drawArrays(const SoftVertexStream& stream, GLint first, GLsizei count, SoftShading shading,
+                    uint32_t flat_color = 0xFFFFFFFFu, const SoftTexture* texture = nullptr) {
+        assert(this->m_target);
+        for (GLint v = first; v + 2 < first + count; v += 3) {
+            float x[3], y[3], attributes[3][3] = {{0.0f}};
+            for (int i = 0; i < 3; ++i) {
+                const float* position = reinterpret_cast<const float*>(
+                        stream.data + stream.positionOffset + size_t(v + i) * stream.positionStride);
+                // normalized device coordinates to window coordinates
+                x[i] = this->m_viewport[0] + (position[0] + 1.0f) * 0.5f * this->m_viewport[2];
+                y[i] = this->m_viewport[1] + (position[1] + 1.0f) * 0.5f * this->m_viewport[3];
+
+                const float* attribute = reinterpret_cast<const float*>(
+                        stream.data + stream.attributeOffset + size_t(v + i) * stream.attributeStride);
+                for (int k = 0; k < stream.attributeDimension; ++k) attributes[i][k] = attribute[k];
+            }
+            this->setupTriangle(x, y, attributes, shading, flat_color, texture);
+        }
+    };
+
+    /* shade all binned triangles */
+    void flush() {
+        timeline::Zone zone("SoftRasterizer::flush");
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_nextTile = 0;
+            this->m_busy = unsigned(this->m_workers.size());
+            ++this->m_generation;
+        }
+        this->m_wake.notify_all();
+
+        this->work();
+
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        this->m_done.wait(lock, [this]() { return this->m_busy == 0; });
+    };
+
+public:
+    unsigned threadsCount() const {
+        return unsigned(this->m_workers.size()) + 1;
+    };
+
+    unsigned long trianglesCount() const {
+        return this->m_trianglesCount;
+    };
+
+    unsigned long pixelsCount() const {
+        return this->m_pixelsCount;
+    };
+
+private:
+    void setupTriangle(const float* x, const float* y, const float (*attributes)[3],
+                       SoftShading shading, uint32_t flat_color, const SoftTexture* texture) {
+        Triangle triangle;
+
+        // edge i is opposite to vertex i
+        for (int i = 0; i < 3; ++i) {
+            int j = (i + 1) % 3, k = (i + 2) % 3;
+            triangle.a[i] = y[j] - y[k];
+            triangle.b[i] = x[k] - x[j];
+            triangle.c[i] = x[j] * y[k] - x[k] * y[j];
+        }
+        float area = triangle.c[0] + triangle.c[1] + triangle.c[2];
+        if (area == 0.0f) return;
+        if (area < 0.0f) { // either winding is drawn
+            for (int i = 0; i < 3; ++i) triangle.a[i] = -triangle.a[i], triangle.b[i] = -triangle.b[i],
+                                        triangle.c[i] = -triangle.c[i];
+            area = -area;
+        }
+        triangle.inverseArea = 1.0f / area;
+
+        // top-left rule with y up: a left edge has the inside to its right (a > 0), a top edge is horizontal with
+        // the inside below it (a == 0, b < 0)
+        triangle.inclusive = 0;
+        for (int i = 0; i < 3; ++i) {
+            if (triangle.a[i] > 0.0f || (triangle.a[i] == 0.0f && triangle.b[i] < 0.0f)) triangle.inclusive |= 1 << i;
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            triangle.attribute[k] = attributes[0][k];
+            triangle.dAttribute1[k] = attributes[1][k] - attributes[0][k];
+            triangle.dAttribute2[k] = attributes[2][k] - attributes[0][k];
+        }
+
+        // pixel bounds; pixel centers at +0.5
+        const int* viewport = this->m_viewport;
+        triangle.minX = std::max({int(std::floor(std::min({x[0], x[1], x[2]}))), viewport[0], 0});
+        triangle.minY = std::max({int(std::floor(std::min({y[0], y[1], y[2]}))), viewport[1], 0});
+        triangle.maxX = std::min({int(std::ceil(std::max({x[0], x[1], x[2]}))), viewport[0] + viewport[2] - 1,
+                                  this->m_target->width - 1});
+        triangle.maxY = std::min({int(std::ceil(std::max({y[0], y[1], y[2]}))), viewport[1] + viewport[3] - 1,
+                                  this->m_target->height - 1});
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+        triangle.shading = shading;
+        triangle.flatColor = flat_color;
+        triangle.texture = texture;
+
+        // bin by bounding box
+        uint32_t index = uint32_t(this->m_triangles.size());
+        this->m_triangles.push_back(triangle);
+        for (int tile_y = triangle.minY / TILE_SIZE; tile_y <= triangle.maxY / TILE_SIZE; ++tile_y) {
+            for (int tile_x = triangle.minX / TILE_SIZE; tile_x <= triangle.maxX / TILE_SIZE; ++tile_x) {
+                this->m_bins[size_t(tile_y) * this->m_tilesX + tile_x].push_back(index);
+            }
+        }
+        ++this->m_trianglesCount;
+    };
+
+    void workerLoop() {
+        timeline::setThreadName("raster worker");
+        unsigned long seen = 0;
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        while (true) {
+            this->m_wake.wait(lock, [&]() { return this->m_quit || this->m_generation != seen; });
+            if (this->m_quit) return;
+            seen = this->m_generation;
+
+            lock.unlock();
+            this->work();
+            lock.lock();
+
+            if (--this->m_busy == 0) this->m_done.notify_all();
+        }
+    };
+
+    void work() {
+        timeline::Zone zone("rasterizeTiles");
+        size_t tile;
+        while ((tile = this->m_nextTile++) < this->m_bins.size()) this->rasterizeTile(tile);
+    };
+
+    void rasterizeTile(size_t tile) {
+        const int tile_x = int(tile % this->m_tilesX) * TILE_SIZE, tile_y = int(tile / this->m_tilesX) * TILE_SIZE;
+        unsigned long pixels = 0;
+
+        for (uint32_t index : this->m_bins[tile]) {
+            const Triangle& triangle = this->m_triangles[index];
+            const int min_x = std::max(triangle.minX, tile_x) & ~3; // 4-pixel aligned spans
+            const int max_x = std::min(triangle.maxX, tile_x + TILE_SIZE - 1);
+            const int min_y = std::max(triangle.minY, tile_y), max_y = std::min(triangle.maxY, tile_y + TILE_SIZE - 1);
+            // lanes left of the tile or of the triangle bounds are masked out by x_begin
+            const int x_begin = std::max(triangle.minX, tile_x);
+
+            const Float4 a0 = Float4::splat(triangle.a[0]), a1 = Float4::splat(triangle.a[1]),
+                    a2 = Float4::splat(triangle.a[2]);
+
+            for (int y = min_y; y <= max_y; ++y) {
+                const float center_y = y + 0.5f;
+                uint32_t* row = this->m_target->pixels.data() + size_t(y) * this->m_target->stride;
+                const Float4 row0 = Float4::splat(triangle.b[0] * center_y + triangle.c[0]),
+                        row1 = Float4::splat(triangle.b[1] * center_y + triangle.c[1]),
+                        row2 = Float4::splat(triangle.b[2] * center_y + triangle.c[2]);
+
+                for (int x = min_x; x <= max_x; x += 4) {
+                    const Float4 center_x = Float4::ramp(x + 0.5f);
+                    const Float4 w0 = a0 * center_x + row0, w1 = a1 * center_x + row1, w2 = a2 * center_x + row2;
+
+                    int mask = Float4::insideMask(w0, w1, w2, triangle.inclusive);
+                    for (int lane = 0; lane < 4; ++lane) {
+                        if (x + lane < x_begin || x + lane > max_x) mask &= ~(1 << lane);
+                    }
+                    if (mask == 0) continue;
+
+                    this->shadeSpan(triangle, w1, w2, mask, row + x);
+                    pixels += (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3 & 1);
+                }
+            }
+        }
+
+        this->m_pixelsCount += pixels;
+    };
+
+    /* color up to 4 adjacent pixels selected by mask */
+    void shadeSpan(const Triangle& triangle, const Float4& w1, const Float4& w2, int mask, uint32_t* out) const {
+        uint32_t colors[4];
+
+        if (triangle.shading == SoftShading::Flat) {
+            std::fill(colors, colors + 4, triangle.flatColor);
+        } else {
+            const Float4 inverse_area = Float4::splat(triangle.inverseArea);
+            const Float4 l1 = w1 * inverse_area, l2 = w2 * inverse_area;
+            float values[3][4];
+            const int dimension = triangle.shading == SoftShading::Color ? 3 : 2;
+            for (int k = 0; k < dimension; ++k) {
+                (Float4::splat(triangle.attribute[k]) + l1 * Float4::splat(triangle.dAttribute1[k]) +
+                 l2 * Float4::splat(triangle.dAttribute2[k])).store(values[k]);
+            }
+
+            for (int lane = 0; lane < 4; ++lane) {
+                if (!(mask >> lane & 1)) continue;
+                colors[lane] = triangle.shading == SoftShading::Color ?
+                               packRgba(values[0][lane], values[1][lane], values[2][lane]) :
+                               triangle.texture->sampleNearest(values[0][lane], values[1][lane]);
+            }
+        }
+
+        for (int lane = 0; lane < 4; ++lane) {
+            if (mask >> lane & 1) out[lane] = colors[lane];
+        }
+    };
+};
+
+
+#endif //_SOFT_RASTER_HPP
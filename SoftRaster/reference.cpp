@@ -0,0 +1,147 @@
+#include "../myGL.hpp"
+#include "../SoftRaster.hpp"
+#include "../HelloGL/Geometry.hpp"
+#include "../ColorAttribute/Geometry.hpp"
+
+#include <chrono>
+#include <cstdlib>
+
+
+/* Constants; same window as the demos. */
+static const GLint width = 600;
+static const GLint height = 480;
+
+const std::string texture_image = "Lenna.png";
+
+/* HelloGL: triangle data */
+static const std::vector<GLfloat> vertex_position_data = regularPolygon(0.8f, 3);
+
+/* ColorAttribute: triangle data */
+std::vector<GLfloat> colored_vertex_data;
+auto colored_header = coloredTriangle(0.8f, colored_vertex_data);
+
+/* cvTexture: two triangles, one with color data and the other with texture coordinates */
+std::vector<GLfloat> vertex_data = {
+    // position             // texture        // color
+    0.5f, -0.5f, 0.0f,      1.0f, 0.0f,       1.0f, 0.0f, 0.0f,
+    0.5, 0.5, 0.0f,         1.0f, 1.0f,       0.0f, 1.0f, 0.0f,
+    -0.5f, 0.5f, 0.0f,      0.0f, 1.0f,       0.0f, 0.0f, 1.0f,
+    -0.5f, 0.5f, 0.0f,      0.0f, 1.0f,       1.0f, 1.0f, 1.0f,
+    -0.5f, -0.5f, 0.0f,     0.0f, 0.0f,       0.5f, 0.5f, 0.5f,
+    0.5f, -0.5f, 0.0f,      1.0f, 0.0f,       0.0f, 0.0f, 0.0f
+};
+auto header = VertexBufferHeader<GLfloat>(vertex_data, 6, 3, 0, 2, 3);
+
+
+/* aspect ratio always 1, as GLContext::mainloop() sets it */
+void squareViewport(SoftRasterizer& rasterizer, SoftFramebuffer& framebuffer) {
+    framebuffer.clear(packRgba(0.0f, 0.0f, 0.0f));
+    width >= height ?
+    rasterizer.begin(framebuffer, (width - height) / 2, 0, height, height) :
+    rasterizer.begin(framebuffer, 0, (height - width) / 2, width, width);
+}
+
+/* pixels whose channels differ from golden by more than 1; those are marked red in diff, the rest dimmed */
+int compare(const SoftFramebuffer& framebuffer, const SoftFramebuffer& golden, SoftFramebuffer& diff) {
+    int mismatches = 0;
+    for (int y = 0; y < framebuffer.height; ++y) {
+        for (int x = 0; x < framebuffer.width; ++x) {
+            uint32_t a = framebuffer.pixel(x, y), b = golden.pixel(x, y);
+            bool mismatch = false;
+            for (int shift = 0; shift < 24; shift += 8) {
+                mismatch |= std::abs(int(a >> shift & 0xFF) - int(b >> shift & 0xFF)) > 1;
+            }
+            mismatches += mismatch;
+            diff.pixels[size_t(y) * diff.stride + x] = mismatch ? packRgba(1.0f, 0.0f, 0.0f) : (a >> 2) & 0x3F3F3Fu;
+        }
+    }
+    return mismatches;
+}
+
+/* golden_dir empty: write name.ppm. otherwise compare with golden_dir/name.ppm, writing name.diff.ppm on mismatch */
+bool render(const std::string& name, SoftRasterizer& rasterizer, SoftFramebuffer& framebuffer,
+            const std::string& golden_dir) {
+    auto start = std::chrono::steady_clock::now();
+    rasterizer.flush();
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (golden_dir.empty()) {
+        if (!framebuffer.writePpm(name + ".ppm")) {
+            std::cerr << "Unable to write " << name << ".ppm" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::cout << name << ".ppm: " << elapsed << " ms" << std::endl;
+        return true;
+    }
+
+    SoftFramebuffer golden(framebuffer.width, framebuffer.height), diff(framebuffer.width, framebuffer.height);
+    if (!golden.readPpm(golden_dir + "/" + name + ".ppm")) {
+        std::cerr << "Unable to read golden image " << golden_dir << "/" << name << ".ppm" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    int mismatches = compare(framebuffer, golden, diff);
+    if (mismatches == 0) {
+        std::cout << name << ": matches golden image" << std::endl;
+        return true;
+    }
+    diff.writePpm(name + ".diff.ppm");
+    std::cout << name << ": " << mismatches << " pixels differ from golden image; see " << name << ".diff.ppm"
+              << std::endl;
+    return false;
+}
+
+
+int main(int argc, char* argv[]) {
+    /* usage: SoftRaster [threads] writes hello.ppm, colors.ppm & texture.ppm. SoftRaster check golden_dir compares
+     * them with golden_dir/<name>.ppm instead and fails on any pixel off by more than 1; checks always use the
+     * checkerboard texture, so the golden images do not depend on OpenCV. MYGL_TIMELINE_FILE=file writes the worker
+     * timeline as chrome trace json */
+    const char* timeline_file = std::getenv("MYGL_TIMELINE_FILE");
+    if (timeline_file) timeline::enable();
+    timeline::setThreadName("main");
+
+    const bool check = argc > 2 && std::string(argv[1]) == "check";
+    const std::string golden_dir = check ? argv[2] : "";
+    SoftRasterizer rasterizer(argc > 1 && !check ? unsigned(std::atoi(argv[1])) : std::thread::hardware_concurrency());
+    SoftFramebuffer framebuffer(width, height);
+    bool matched = true;
+
+    /* HelloGL; solid_color.frag */
+    {
+        squareViewport(rasterizer, framebuffer);
+        SoftVertexStream stream = {reinterpret_cast<const unsigned char*>(vertex_position_data.data()),
+                                   0, sizeof(GLfloat) * 3, 0, 0, 0};
+        rasterizer.drawArrays(stream, 0, 3, SoftShading::Flat, packRgba(61.0f / 255, 156.0f / 255, 174.0f / 255));
+        matched &= render("hello", rasterizer, framebuffer, golden_dir);
+    }
+
+    /* ColorAttribute; position & color blocks, tightly packed */
+    {
+        squareViewport(rasterizer, framebuffer);
+        SoftVertexStream stream = {reinterpret_cast<const unsigned char*>(colored_header.bufferData()),
+                                   GLsizei((GLintptr)colored_header.positionDataOffset()), sizeof(GLfloat) * 3,
+                                   GLsizei((GLintptr)colored_header.colorDataOffset()), sizeof(GLfloat) * 3, 3};
+        rasterizer.drawArrays(stream, 0, colored_header.verticesCount(), SoftShading::Color);
+        matched &= render("colors", rasterizer, framebuffer, golden_dir);
+    }
+
+    /* cvTexture; the color triangle, then the textured one */
+    {
+#ifndef MYGL_NO_OPENCV
+        SoftTexture texture = check ? SoftTexture::checkerboard(512, 8) :
+                                      SoftTexture::fromImage(readRgbImage(texture_image));
+#else
+        SoftTexture texture = SoftTexture::checkerboard(512, 8);
+#endif
+        squareViewport(rasterizer, framebuffer);
+        rasterizer.drawArrays(softVertexStream(header, header.colorDataOffset(), header.colorVecDimension()),
+                              0, header.verticesCount() / 2, SoftShading::Color);
+        rasterizer.drawArrays(softVertexStream(header, header.uvDataOffset(), header.uvVecDimension()),
+                              header.verticesCount() / 2, header.verticesCount() / 2, SoftShading::Texture,
+                              0, &texture);
+        matched &= render("texture", rasterizer, framebuffer, golden_dir);
+    }
+
+    if (timeline_file) timeline::writeChromeJson(timeline_file);
+    return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,239 @@
+//
+// Created by pallas athena on 16/10/5.
+//
+
+#ifndef _TIMELINE_HPP
+#define _TIMELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/* cross-thread timeline of named zones, exported in the chrome trace event format (chrome://tracing, Perfetto UI).
+ * every thread appends to its own buffer without locks; the mutex is only taken when a thread records its first
+ * zone. recording is off until enable() is called, and a disabled zone costs one relaxed load. */
+namespace timeline {
+
+    /* nanoseconds on the steady clock; the common time base of every track */
+    inline uint64_t now() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    };
+
+    struct Event {
+        const char* name; // static string
+        char detail[48]; // e.g. a file name; truncated
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    /* single writer, any number of readers: events are complete before count is published */
+    struct Chunk {
+        static const size_t CAPACITY = 1024;
+        Event events[CAPACITY];
+        std::atomic<size_t> count{0};
+        std::atomic<Chunk*> next{nullptr};
+    };
+
+    /* events of one thread, or of a virtual track such as the gpu; owned by the registry so they outlive threads */
+    class Track {
+        friend class Registry; // the name is only touched with the registry's mutex held
+
+    private:
+        unsigned m_id;
+        std::string m_name; // renamed by the owning thread while another may export it
+        Chunk* m_head;
+        Chunk* m_tail;
+
+    public:
+        Track(unsigned id, const std::string& name) : m_id(id), m_name(name), m_head(new Chunk), m_tail(m_head) {};
+
+        ~Track() {
+            Chunk* chunk = this->m_head;
+            while (chunk) {
+                Chunk* next = chunk->next.load();
+                delete chunk;
+                chunk = next;
+            }
+        };
+
+        Track(const Track&) = delete;
+        Track& operator=(const Track&) = delete;
+
+    public:
+        unsigned id() const {
+            return this->m_id;
+        };
+
+        /* owning thread only */
+        void append(const char* name, const char* detail, uint64_t begin, uint64_t end) {
+            size_t count = this->m_tail->count.load(std::memory_order_relaxed);
+            if (count == Chunk::CAPACITY) {
+                Chunk* chunk = new Chunk;
+                this->m_tail->next.store(chunk, std::memory_order_release);
+                this->m_tail = chunk;
+                count = 0;
+            }
+            Event& event = this->m_tail->events[count];
+            event.name = name;
+            event.detail[0] = '\0';
+            if (detail) {
+                std::strncpy(event.detail, detail, sizeof(event.detail) - 1);
+                event.detail[sizeof(event.detail) - 1] = '\0';
+            }
+            event.begin = begin;
+            event.end = end;
+            this->m_tail->count.store(count + 1, std::memory_order_release);
+        };
+
+        /* any thread; sees every event published so far */
+        template <typename Visit>
+        void forEach(Visit visit) const {
+            for (const Chunk* chunk = this->m_head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+                size_t count = chunk->count.load(std::memory_order_acquire);
+                for (size_t i = 0; i < count; ++i) visit(chunk->events[i]);
+            }
+        };
+    };
+
+    class Registry {
+    private:
+        std::mutex m_mutex;
+        std::vector<std::unique_ptr<Track>> m_tracks;
+        std::atomic<bool> m_enabled{false};
+
+    public:
+        static Registry& instance() {
+            static Registry registry;
+            return registry;
+        };
+
+        bool enabled() const {
+            return this->m_enabled.load(std::memory_order_relaxed);
+        };
+
+        void setEnabled(bool enabled) {
+            this->m_enabled.store(enabled, std::memory_order_relaxed);
+        };
+
+        /* empty name: "thread <id>" */
+        Track& create(const std::string& name) {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            unsigned id = unsigned(this->m_tracks.size()) + 1;
+            this->m_tracks.emplace_back(new Track(id, name.empty() ? "thread " + std::to_string(id) : name));
+            return *this->m_tracks.back();
+        };
+
+        /* the calling thread's track; created on its first zone */
+        Track& local() {
+            Track*& track = localTrack();
+            if (!track) track = &this->create(localName());
+            return *track;
+        };
+
+        /* name of the calling thread's track; kept until the track exists so that idle threads cost nothing */
+        void setLocalName(const std::string& name) {
+            if (localTrack()) {
+                std::lock_guard<std::mutex> lock(this->m_mutex); // writeChromeJson() may be reading it
+                localTrack()->m_name = name;
+            } else {
+                localName() = name;
+            }
+        };
+
+        /* chrome trace event json; complete ("X") events in microseconds, one tid per track */
+        void writeChromeJson(std::ostream& out) {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+
+            out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            bool first = true;
+            for (const std::unique_ptr<Track>& track : this->m_tracks) {
+                out << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"
+                    << track->id() << ",\"args\":{\"name\":\"" << escape(track->m_name) << "\"}}";
+                first = false;
+
+                track->forEach([&out, &track](const Event& event) {
+                    char times[96];
+                    std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", event.begin / 1e3,
+                                  (event.end - event.begin) / 1e3);
+                    out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << track->id() << ",\"name\":\""
+                        << escape(event.name) << "\"," << times;
+                    if (event.detail[0]) out << ",\"args\":{\"detail\":\"" << escape(event.detail) << "\"}";
+                    out << "}";
+                });
+            }
+            out << "\n]}\n";
+        };
+
+    private:
+        static Track*& localTrack() {
+            static thread_local Track* track = nullptr;
+            return track;
+        };
+
+        static std::string& localName() {
+            static thread_local std::string name;
+            return name;
+        };
+
+        static std::string escape(const std::string& text) {
+            std::string escaped;
+            for (char c : text) {
+                if (c == '"' || c == '\\') escaped += '\\';
+                if (static_cast<unsigned char>(c) < 0x20) continue;
+                escaped += c;
+            }
+            return escaped;
+        };
+    };
+
+    inline void enable() { Registry::instance().setEnabled(true); };
+    inline void disable() { Registry::instance().setEnabled(false); };
+    inline bool enabled() { return Registry::instance().enabled(); };
+
+    /* name of the calling thread's track */
+    inline void setThreadName(const std::string& name) { Registry::instance().setLocalName(name); };
+
+    inline void writeChromeJson(const std::string& file) {
+        std::ofstream out(file);
+        if (!out.is_open()) {
+            std::cerr << "Unable to write timeline file: " + file << std::endl;
+            return;
+        }
+        Registry::instance().writeChromeJson(out);
+    };
+
+
+    /* scoped zone on the calling thread; name must be a string literal, detail must outlive the zone */
+    class Zone {
+    private:
+        const char* m_name;
+        const char* m_detail;
+        uint64_t m_begin;
+
+    public:
+        explicit Zone(const char* name, const char* detail = nullptr) :
+                m_name(enabled() ? name : nullptr), m_detail(detail), m_begin(m_name ? now() : 0) {};
+
+        Zone(const char* name, const std::string& detail) : Zone(name, detail.c_str()) {};
+
+        ~Zone() {
+            if (this->m_name) Registry::instance().local().append(this->m_name, this->m_detail, this->m_begin, now());
+        };
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    };
+};
+
+
+#endif //_TIMELINE_HPP
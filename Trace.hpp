@@ -0,0 +1,823 @@
+//
+// Created by pallas athena on 16/10/3.
+//
+
+#ifndef _TRACE_HPP
+#define _TRACE_HPP
+
+/* gl call trace recording & reading. myGL.hpp includes this right after the gl headers when MYGL_TRACE is defined;
+ * the gl functions used by this repository are then redirected to wrappers which forward the call and, while a
+ * recording is active, append it with its arguments and referenced payloads (buffer data, texture pixels, shader
+ * sources) to a trace file. the calls left out only read state or results back (glGet*, query results, syncs,
+ * glReadPixels), which a replay does not need; a buffer mapped for writing ends the program while recording, as its
+ * writes cannot be recorded. Replay/replay.cpp plays a trace back. */
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace gltrace {
+
+    /* file layout, native endianness: FileHeader, then records of RecordHeader, argc 64 bit arguments and a blob
+     * padded to 8 bytes; every record starts 8-byte aligned so that a mapped file can be read in place */
+    const char MAGIC[4] = {'G', 'L', 'T', 'R'};
+    const uint32_t VERSION = 1;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+    };
+
+    struct RecordHeader {
+        uint16_t op;
+        uint16_t argc;
+        uint32_t blobSize;
+    };
+
+    enum class Op : uint16_t {
+        Frame = 0, // end of a frame; buffers swapped
+        GenBuffers, DeleteBuffers, BindBuffer, BufferData, BufferSubData,
+        GenVertexArrays, DeleteVertexArrays, BindVertexArray, EnableVertexAttribArray, VertexAttribPointer,
+        GenTextures, DeleteTextures, BindTexture, ActiveTexture, TexParameteri, PixelStorei, TexImage2D,
+        CreateShader, ShaderSource, CompileShader, DeleteShader,
+        CreateProgram, AttachShader, DetachShader, LinkProgram, DeleteProgram, UseProgram,
+        GetUniformLocation, Uniform1i, Uniform1f, Uniform2f,
+        ClearColor, Clear, Viewport, Enable, Disable,
+        DrawArrays, DrawArraysInstanced, DrawElements, DrawElementsBaseVertex,
+        TexSubImage2D,
+        GenFramebuffers, DeleteFramebuffers, BindFramebuffer, FramebufferTexture2D, FramebufferRenderbuffer,
+        GenRenderbuffers, DeleteRenderbuffers, BindRenderbuffer, RenderbufferStorageMultisample,
+        BlitFramebuffer, InvalidateFramebuffer, DepthMask, ColorMask, Uniform3fv, UniformMatrix4fv,
+        DrawElementsInstancedBaseVertex, MultiDrawElementsBaseVertex,
+        DrawArraysIndirect, DrawElementsIndirect, MultiDrawArraysIndirect, MultiDrawElementsIndirect,
+        GenQueries, DeleteQueries, BeginQuery, EndQuery, QueryCounter, BeginConditionalRender, EndConditionalRender,
+        Count
+    };
+
+    inline uint64_t floatBits(GLfloat f) {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    };
+
+    inline GLfloat bitsFloat(uint64_t bits) {
+        uint32_t low = uint32_t(bits);
+        GLfloat f;
+        std::memcpy(&f, &low, sizeof(f));
+        return f;
+    };
+
+
+    /* arguments each op is recorded with; a record with fewer comes from a corrupt trace */
+    inline uint16_t argumentsCount(Op op) {
+        static const uint16_t counts[] = {
+                0, // Frame
+                1, 1, 2, 4, 3, // GenBuffers .. BufferSubData
+                1, 1, 1, 1, 6, // GenVertexArrays .. VertexAttribPointer
+                1, 1, 2, 1, 3, 2, 8, // GenTextures .. TexImage2D
+                2, 1, 1, 1, // CreateShader .. DeleteShader
+                1, 2, 2, 1, 1, 1, // CreateProgram .. UseProgram
+                2, 2, 2, 3, // GetUniformLocation .. Uniform2f
+                4, 1, 4, 1, 1, // ClearColor .. Disable
+                3, 4, 4, 5, // DrawArrays .. DrawElementsBaseVertex
+                8, // TexSubImage2D
+                1, 1, 2, 5, 4, // GenFramebuffers .. FramebufferRenderbuffer
+                1, 1, 2, 5, // GenRenderbuffers .. RenderbufferStorageMultisample
+                10, 2, 1, 4, 2, 3, // BlitFramebuffer .. UniformMatrix4fv
+                6, 3, // DrawElementsInstancedBaseVertex, MultiDrawElementsBaseVertex
+                2, 3, 4, 5, // DrawArraysIndirect .. MultiDrawElementsIndirect
+                1, 1, 2, 1, 2, 2, 0 // GenQueries .. EndConditionalRender
+        };
+        static_assert(sizeof(counts) / sizeof(counts[0]) == size_t(Op::Count), "one arguments count per op");
+        return counts[size_t(op)];
+    };
+
+    /* bytes per pixel of client memory in format & type; 0 if unknown */
+    inline uint64_t pixelSize(GLenum format, GLenum type) {
+        switch (type) {
+            case GL_UNSIGNED_BYTE_3_3_2: case GL_UNSIGNED_BYTE_2_3_3_REV:
+                return 1;
+            case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_5_6_5_REV:
+            case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+            case GL_UNSIGNED_SHORT_5_5_5_1: case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+                return 2;
+            case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV:
+            case GL_UNSIGNED_INT_10_10_10_2: case GL_UNSIGNED_INT_2_10_10_10_REV:
+            case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_10F_11F_11F_REV: case GL_UNSIGNED_INT_5_9_9_9_REV:
+                return 4;
+            case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+                return 8;
+            default:
+                break;
+        }
+        uint64_t components = format == GL_RED || format == GL_RED_INTEGER || format == GL_DEPTH_COMPONENT ||
+                              format == GL_STENCIL_INDEX ? 1 :
+                              format == GL_RG || format == GL_RG_INTEGER ? 2 :
+                              format == GL_RGB || format == GL_BGR || format == GL_RGB_INTEGER ||
+                              format == GL_BGR_INTEGER ? 3 : 4;
+        uint64_t component_size = type == GL_UNSIGNED_BYTE || type == GL_BYTE ? 1 :
+                                  type == GL_UNSIGNED_SHORT || type == GL_SHORT || type == GL_HALF_FLOAT ? 2 :
+                                  type == GL_UNSIGNED_INT || type == GL_INT || type == GL_FLOAT ? 4 : 0;
+        return components * component_size;
+    };
+
+    /* pixel unpack state, needed to know how many bytes glTexImage2D & glTexSubImage2D read from client memory */
+    struct UnpackState {
+        GLint alignment = 4;
+        GLint rowLength = 0;
+        GLint skipPixels = 0;
+        GLint skipRows = 0;
+
+        /* follows glPixelStorei; values gl rejects leave the state as it is */
+        void pixelStore(GLenum name, GLint value) {
+            if (name == GL_UNPACK_ALIGNMENT && (value == 1 || value == 2 || value == 4 || value == 8)) {
+                this->alignment = value;
+            }
+            if (value < 0) return;
+            if (name == GL_UNPACK_ROW_LENGTH) this->rowLength = value;
+            if (name == GL_UNPACK_SKIP_PIXELS) this->skipPixels = value;
+            if (name == GL_UNPACK_SKIP_ROWS) this->skipRows = value;
+        };
+
+        /* bytes read for a width x height image; UINT64_MAX for a call gl rejects or an unknown format & type */
+        uint64_t imageSize(GLsizei width, GLsizei height, GLenum format, GLenum type) const {
+            uint64_t pixel = pixelSize(format, type);
+            if (width < 0 || height < 0 || pixel == 0) return UINT64_MAX;
+            if (width == 0 || height == 0) return 0;
+            // the arguments are below 2^32 and a pixel at most 16 bytes; only stride * rows can overflow
+            uint64_t row_pixels = this->rowLength > 0 ? uint64_t(this->rowLength) : uint64_t(width);
+            uint64_t align = uint64_t(this->alignment);
+            uint64_t stride = (row_pixels * pixel + align - 1) / align * align;
+            uint64_t rows = uint64_t(this->skipRows) + uint64_t(height) - 1;
+            if (rows > (UINT64_MAX / 2) / stride) return UINT64_MAX;
+            return stride * rows + (uint64_t(this->skipPixels) + uint64_t(width)) * pixel;
+        };
+    };
+
+
+    /* the recording in progress; one per process, for the thread owning the recorded context */
+    class Recorder {
+    private:
+        FILE* m_file = nullptr;
+        unsigned long m_records = 0;
+        unsigned long m_frames = 0;
+        unsigned long long m_bytes = 0;
+
+        UnpackState m_unpack;
+
+    public:
+        static Recorder& instance() {
+            static Recorder recorder;
+            return recorder;
+        };
+
+        ~Recorder() {
+            this->stop();
+        };
+
+        bool active() const {
+            return this->m_file != nullptr;
+        };
+
+        void start(const std::string& file) {
+            this->stop();
+            this->m_file = std::fopen(file.c_str(), "wb");
+            if (!this->m_file) {
+                std::cerr << "Unable to open trace file: " + file << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            FileHeader header;
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            std::fwrite(&header, sizeof(header), 1, this->m_file);
+            this->m_records = this->m_frames = 0;
+            this->m_bytes = sizeof(header);
+        };
+
+        void stop() {
+            if (!this->m_file) return;
+            std::fclose(this->m_file);
+            this->m_file = nullptr;
+            std::cout << "trace: " << this->m_frames << " frames, " << this->m_records << " calls, "
+                      << this->m_bytes << " bytes" << std::endl;
+        };
+
+        void record(Op op, std::initializer_list<uint64_t> args, const void* blob = nullptr, size_t blob_size = 0) {
+            if (!this->m_file) return;
+            RecordHeader header = {uint16_t(op), uint16_t(args.size()), uint32_t(blob_size)};
+            std::fwrite(&header, sizeof(header), 1, this->m_file);
+            std::fwrite(args.begin(), sizeof(uint64_t), args.size(), this->m_file);
+
+            static const char padding[8] = {0};
+            size_t padded = (blob_size + 7) & ~size_t(7);
+            if (blob_size) std::fwrite(blob, 1, blob_size, this->m_file);
+            std::fwrite(padding, 1, padded - blob_size, this->m_file);
+
+            ++this->m_records;
+            if (op == Op::Frame) ++this->m_frames;
+            this->m_bytes += sizeof(header) + sizeof(uint64_t) * args.size() + padded;
+        };
+
+        void pixelStore(GLenum name, GLint value) {
+            this->m_unpack.pixelStore(name, value);
+        };
+
+        /* bytes glTexImage2D / glTexSubImage2D read from client memory under the current unpack state; 0 when gl
+         * rejects the call and reads nothing */
+        size_t imageSize(GLsizei width, GLsizei height, GLenum format, GLenum type) const {
+            uint64_t size = this->m_unpack.imageSize(width, height, format, type);
+            return size == UINT64_MAX ? 0 : size_t(size);
+        };
+    };
+
+    inline void start(const std::string& file) { Recorder::instance().start(file); };
+    inline void stop() { Recorder::instance().stop(); };
+    inline void frame() { Recorder::instance().record(Op::Frame, {}); };
+
+    inline Recorder& rec() { return Recorder::instance(); };
+
+
+    /* one record of a mapped trace; pointers into the mapping */
+    struct Record {
+        size_t offset; // of the record in the file
+        Op op;
+        uint16_t argc;
+        const uint64_t* args;
+        const void* blob;
+        uint32_t blobSize;
+    };
+
+    /* read-only mapping of a trace file; records are read in place without copies */
+    class TraceFile {
+    private:
+        std::string m_file;
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+
+        void fail(size_t offset, const std::string& reason) const {
+            std::cerr << "Invalid trace file " + this->m_file + ": " + reason + " at offset " << offset << std::endl;
+            exit(EXIT_FAILURE);
+        };
+
+    public:
+        explicit TraceFile(const std::string& file) : m_file(file) {
+            int fd = open(file.c_str(), O_RDONLY);
+            struct stat status;
+            if (fd < 0 || fstat(fd, &status) != 0 || size_t(status.st_size) < sizeof(FileHeader)) {
+                std::cerr << "Unable to read trace file: " + file << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            this->m_size = size_t(status.st_size);
+            void* data = mmap(nullptr, this->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED) {
+                std::cerr << "Unable to map trace file: " + file << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            this->m_data = static_cast<const char*>(data);
+
+            const FileHeader* header = reinterpret_cast<const FileHeader*>(this->m_data);
+            if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) {
+                std::cerr << "Not a version " << VERSION << " trace file: " + file << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        };
+
+        ~TraceFile() {
+            if (this->m_data) munmap(const_cast<char*>(this->m_data), this->m_size);
+        };
+
+        TraceFile(const TraceFile&) = delete;
+        TraceFile& operator=(const TraceFile&) = delete;
+
+    public:
+        /* offset of the first record */
+        size_t begin() const {
+            return sizeof(FileHeader);
+        };
+
+        size_t end() const {
+            return this->m_size;
+        };
+
+        /* exits unless the record's blob holds count elements of element_size bytes, as replaying it passes gl that
+         * many */
+        void requireBlob(const Record& record, uint64_t count, uint64_t element_size = 1) const {
+            if (count > record.blobSize / element_size) this->fail(record.offset, "truncated record");
+        };
+
+        /* exits unless the pixels of a TexImage2D or TexSubImage2D record cover what gl reads under unpack; a
+         * TexImage2D without pixels reads nothing */
+        void requirePixels(const Record& record, const UnpackState& unpack) const {
+            assert(record.op == Op::TexImage2D || record.op == Op::TexSubImage2D);
+            const uint64_t* a = record.args;
+            if (record.op == Op::TexImage2D && record.blobSize == 0) return;
+            uint64_t size = record.op == Op::TexImage2D ?
+                            unpack.imageSize(GLsizei(a[3]), GLsizei(a[4]), GLenum(a[6]), GLenum(a[7])) :
+                            unpack.imageSize(GLsizei(a[4]), GLsizei(a[5]), GLenum(a[6]), GLenum(a[7]));
+            this->requireBlob(record, size);
+        };
+
+        /* record at offset; offset is advanced to the next one. exits if the record does not fit in the file, has
+         * fewer arguments than its op or a blob shorter than the sizes in its arguments, as a truncated or corrupt
+         * trace would otherwise be replayed from beyond the mapping. texture pixels depend on the unpack state at
+         * replay; see requirePixels() */
+        Record next(size_t& offset) const {
+            if (offset > this->m_size || this->m_size - offset < sizeof(RecordHeader)) {
+                this->fail(offset, "truncated record header");
+            }
+            const RecordHeader* header = reinterpret_cast<const RecordHeader*>(this->m_data + offset);
+            if (header->op >= uint16_t(Op::Count)) this->fail(offset, "unknown op " + std::to_string(header->op));
+
+            // sizes are at most 2^19 + 2^32 bytes; no overflow in 64 bits
+            uint64_t size = sizeof(RecordHeader) + sizeof(uint64_t) * uint64_t(header->argc) +
+                            ((uint64_t(header->blobSize) + 7) & ~uint64_t(7));
+            if (size > this->m_size - offset) this->fail(offset, "truncated record");
+
+            Record record;
+            record.offset = offset;
+            record.op = Op(header->op);
+            record.argc = header->argc;
+            record.args = reinterpret_cast<const uint64_t*>(header + 1);
+            record.blob = record.args + header->argc;
+            record.blobSize = header->blobSize;
+            if (record.argc < argumentsCount(record.op)) this->fail(offset, "truncated record");
+
+            const uint64_t* a = record.args;
+            switch (record.op) {
+                case Op::GenBuffers: case Op::DeleteBuffers: case Op::GenVertexArrays: case Op::DeleteVertexArrays:
+                case Op::GenTextures: case Op::DeleteTextures: case Op::GenFramebuffers: case Op::DeleteFramebuffers:
+                case Op::GenRenderbuffers: case Op::DeleteRenderbuffers: case Op::GenQueries: case Op::DeleteQueries:
+                    this->requireBlob(record, a[0], sizeof(GLuint));
+                    break;
+                case Op::InvalidateFramebuffer:
+                    this->requireBlob(record, a[1], sizeof(GLenum));
+                    break;
+                case Op::Uniform3fv:
+                    this->requireBlob(record, a[1], 3 * sizeof(GLfloat));
+                    break;
+                case Op::UniformMatrix4fv:
+                    this->requireBlob(record, a[1], 16 * sizeof(GLfloat));
+                    break;
+                case Op::MultiDrawElementsBaseVertex:
+                    this->requireBlob(record, a[2], sizeof(uint64_t) + sizeof(GLsizei) + sizeof(GLint));
+                    break;
+                case Op::BufferData:
+                    if (a[3]) this->requireBlob(record, a[1]);
+                    break;
+                case Op::BufferSubData:
+                    this->requireBlob(record, a[2]);
+                    break;
+                default:
+                    break;
+            }
+            offset += size_t(size);
+            return record;
+        };
+    };
+
+
+    /* a call whose effect cannot be recorded; replaying the trace would draw something else */
+    inline void untraced(const std::string& call) {
+        std::cerr << "Unable to record gl call: " + call << std::endl;
+        exit(EXIT_FAILURE);
+    };
+
+
+    /* wrappers; the parentheses around the gl function names keep the macros below from expanding */
+    inline void genBuffers(GLsizei n, GLuint* names) {
+        (glGenBuffers)(n, names);
+        rec().record(Op::GenBuffers, {uint64_t(n)}, names, sizeof(GLuint) * n);
+    };
+    inline void deleteBuffers(GLsizei n, const GLuint* names) {
+        rec().record(Op::DeleteBuffers, {uint64_t(n)}, names, sizeof(GLuint) * n);
+        (glDeleteBuffers)(n, names);
+    };
+    inline void bindBuffer(GLenum target, GLuint name) {
+        (glBindBuffer)(target, name);
+        rec().record(Op::BindBuffer, {target, name});
+    };
+    inline void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+        (glBufferData)(target, size, data, usage);
+        rec().record(Op::BufferData, {target, uint64_t(size), usage, data != nullptr}, data, data ? size_t(size) : 0);
+    };
+    inline void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+        (glBufferSubData)(target, offset, size, data);
+        rec().record(Op::BufferSubData, {target, uint64_t(offset), uint64_t(size)}, data, size_t(size));
+    };
+
+    inline void genVertexArrays(GLsizei n, GLuint* names) {
+        (glGenVertexArrays)(n, names);
+        rec().record(Op::GenVertexArrays, {uint64_t(n)}, names, sizeof(GLuint) * n);
+    };
+    inline void deleteVertexArrays(GLsizei n, const GLuint* names) {
+        rec().record(Op::DeleteVertexArrays, {uint64_t(n)}, names, sizeof(GLuint) * n);
+        (glDeleteVertexArrays)(n, names);
+    };
+    inline void bindVertexArray(GLuint name) {
+        (glBindVertexArray)(name);
+        rec().record(Op::BindVertexArray, {name});
+    };
+    inline void enableVertexAttribArray(GLuint index) {
+        (glEnableVertexAttribArray)(index);
+        rec().record(Op::EnableVertexAttribArray, {index});
+    };
+    inline void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                                    const void* pointer) {
+        (glVertexAttribPointer)(index, size, type, normalized, stride, pointer);
+        rec().record(Op::VertexAttribPointer, {index, uint64_t(size), type, normalized, uint64_t(stride),
+                                               uint64_t(reinterpret_cast<uintptr_t>(pointer))});
+    };
+
+    inline void genTextures(GLsizei n, GLuint* names) {
+        (glGenTextures)(n, names);
+        rec().record(Op::GenTextures, {uint64_t(n)}, names, sizeof(GLuint) * n);
+    };
+    inline void deleteTextures(GLsizei n, const GLuint* names) {
+        rec().record(Op::DeleteTextures, {uint64_t(n)}, names, sizeof(GLuint) * n);
+        (glDeleteTextures)(n, names);
+    };
+    inline void bindTexture(GLenum target, GLuint name) {
+        (glBindTexture)(target, name);
+        rec().record(Op::BindTexture, {target, name});
+    };
+    inline void activeTexture(GLenum unit) {
+        (glActiveTexture)(unit);
+        rec().record(Op::ActiveTexture, {unit});
+    };
+    inline void texParameteri(GLenum target, GLenum name, GLint value) {
+        (glTexParameteri)(target, name, value);
+        rec().record(Op::TexParameteri, {target, name, uint64_t(value)});
+    };
+    inline void pixelStorei(GLenum name, GLint value) {
+        (glPixelStorei)(name, value);
+        rec().pixelStore(name, value);
+        rec().record(Op::PixelStorei, {name, uint64_t(value)});
+    };
+    inline void texImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height,
+                           GLint border, GLenum format, GLenum type, const void* pixels) {
+        (glTexImage2D)(target, level, internal_format, width, height, border, format, type, pixels);
+        size_t size = pixels ? rec().imageSize(width, height, format, type) : 0;
+        rec().record(Op::TexImage2D, {target, uint64_t(level), uint64_t(internal_format), uint64_t(width),
+                                      uint64_t(height), uint64_t(border), format, type}, pixels, size);
+    };
+    inline void texSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                              GLenum format, GLenum type, const void* pixels) {
+        (glTexSubImage2D)(target, level, x, y, width, height, format, type, pixels);
+        size_t size = pixels ? rec().imageSize(width, height, format, type) : 0;
+        rec().record(Op::TexSubImage2D, {target, uint64_t(level), uint64_t(x), uint64_t(y), uint64_t(width),
+                                         uint64_t(height), format, type}, pixels, size);
+    };
+
+    inline GLuint createShader(GLenum type) {
+        GLuint name = (glCreateShader)(type);
+        rec().record(Op::CreateShader, {type, name});
+        return name;
+    };
+    inline void shaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+        (glShaderSource)(shader, count, strings, lengths);
+        std::string source;
+        for (GLsizei i = 0; i < count; ++i) {
+            source += lengths && lengths[i] >= 0 ? std::string(strings[i], size_t(lengths[i])) : std::string(strings[i]);
+        }
+        rec().record(Op::ShaderSource, {shader}, source.data(), source.size());
+    };
+    inline void compileShader(GLuint shader) {
+        (glCompileShader)(shader);
+        rec().record(Op::CompileShader, {shader});
+    };
+    inline void deleteShader(GLuint shader) {
+        rec().record(Op::DeleteShader, {shader});
+        (glDeleteShader)(shader);
+    };
+    inline GLuint createProgram() {
+        GLuint name = (glCreateProgram)();
+        rec().record(Op::CreateProgram, {name});
+        return name;
+    };
+    inline void attachShader(GLuint program, GLuint shader) {
+        (glAttachShader)(program, shader);
+        rec().record(Op::AttachShader, {program, shader});
+    };
+    inline void detachShader(GLuint program, GLuint shader) {
+        (glDetachShader)(program, shader);
+        rec().record(Op::DetachShader, {program, shader});
+    };
+    inline void linkProgram(GLuint program) {
+        (glLinkProgram)(program);
+        rec().record(Op::LinkProgram, {program});
+    };
+    inline void deleteProgram(GLuint program) {
+        rec().record(Op::DeleteProgram, {program});
+        (glDeleteProgram)(program);
+    };
+    inline void useProgram(GLuint program) {
+        (glUseProgram)(program);
+        rec().record(Op::UseProgram, {program});
+    };
+    inline GLint getUniformLocation(GLuint program, const GLchar* name) {
+        GLint location = (glGetUniformLocation)(program, name);
+        rec().record(Op::GetUniformLocation, {program, uint64_t(int64_t(location))}, name, std::strlen(name));
+        return location;
+    };
+    inline void uniform1i(GLint location, GLint value) {
+        (glUniform1i)(location, value);
+        rec().record(Op::Uniform1i, {uint64_t(int64_t(location)), uint64_t(int64_t(value))});
+    };
+    inline void uniform1f(GLint location, GLfloat value) {
+        (glUniform1f)(location, value);
+        rec().record(Op::Uniform1f, {uint64_t(int64_t(location)), floatBits(value)});
+    };
+    inline void uniform2f(GLint location, GLfloat x, GLfloat y) {
+        (glUniform2f)(location, x, y);
+        rec().record(Op::Uniform2f, {uint64_t(int64_t(location)), floatBits(x), floatBits(y)});
+    };
+
+    inline void clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+        (glClearColor)(r, g, b, a);
+        rec().record(Op::ClearColor, {floatBits(r), floatBits(g), floatBits(b), floatBits(a)});
+    };
+    inline void clear(GLbitfield mask) {
+        (glClear)(mask);
+        rec().record(Op::Clear, {mask});
+    };
+    inline void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        (glViewport)(x, y, width, height);
+        rec().record(Op::Viewport, {uint64_t(int64_t(x)), uint64_t(int64_t(y)), uint64_t(width), uint64_t(height)});
+    };
+    inline void enable(GLenum capability) {
+        (glEnable)(capability);
+        rec().record(Op::Enable, {capability});
+    };
+    inline void disable(GLenum capability) {
+        (glDisable)(capability);
+        rec().record(Op::Disable, {capability});
+    };
+
+    inline void drawArrays(GLenum mode, GLint first, GLsizei count) {
+        (glDrawArrays)(mode, first, count);
+        rec().record(Op::DrawArrays, {mode, uint64_t(first), uint64_t(count)});
+    };
+    inline void drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+        (glDrawArraysInstanced)(mode, first, count, instances);
+        rec().record(Op::DrawArraysInstanced, {mode, uint64_t(first), uint64_t(count), uint64_t(instances)});
+    };
+    inline void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+        (glDrawElements)(mode, count, type, indices);
+        rec().record(Op::DrawElements, {mode, uint64_t(count), type, uint64_t(reinterpret_cast<uintptr_t>(indices))});
+    };
+    inline void drawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                       GLint base_vertex) {
+        (glDrawElementsBaseVertex)(mode, count, type, indices, base_vertex);
+        rec().record(Op::DrawElementsBaseVertex, {mode, uint64_t(count), type,
+                                                  uint64_t(reinterpret_cast<uintptr_t>(indices)),
+                                                  uint64_t(int64_t(base_vertex))});
+    };
+    inline void drawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                                GLsizei instances, GLint base_vertex) {
+        (glDrawElementsInstancedBaseVertex)(mode, count, type, indices, instances, base_vertex);
+        rec().record(Op::DrawElementsInstancedBaseVertex, {mode, uint64_t(count), type,
+                                                           uint64_t(reinterpret_cast<uintptr_t>(indices)),
+                                                           uint64_t(instances), uint64_t(int64_t(base_vertex))});
+    };
+    /* blob: the index offsets as 64 bit values, then the counts, then the base vertices */
+    inline void multiDrawElementsBaseVertex(GLenum mode, const GLsizei* counts, GLenum type,
+                                            const void* const* indices, GLsizei draws, const GLint* base_vertices) {
+        (glMultiDrawElementsBaseVertex)(mode, counts, type, indices, draws, base_vertices);
+        if (!rec().active()) return;
+        std::vector<uint64_t> blob(2 * size_t(draws)); // an offset, or a count & a base vertex, per 64 bits
+        for (GLsizei i = 0; i < draws; ++i) blob[i] = uint64_t(reinterpret_cast<uintptr_t>(indices[i]));
+        GLint* ints = reinterpret_cast<GLint*>(blob.data() + draws);
+        std::memcpy(ints, counts, sizeof(GLsizei) * draws);
+        std::memcpy(ints + draws, base_vertices, sizeof(GLint) * draws);
+        rec().record(Op::MultiDrawElementsBaseVertex, {mode, type, uint64_t(draws)}, blob.data(),
+                     (sizeof(uint64_t) + sizeof(GLsizei) + sizeof(GLint)) * draws);
+    };
+#ifdef GL_VERSION_4_0
+    inline void drawArraysIndirect(GLenum mode, const void* indirect) {
+        (glDrawArraysIndirect)(mode, indirect);
+        rec().record(Op::DrawArraysIndirect, {mode, uint64_t(reinterpret_cast<uintptr_t>(indirect))});
+    };
+    inline void drawElementsIndirect(GLenum mode, GLenum type, const void* indirect) {
+        (glDrawElementsIndirect)(mode, type, indirect);
+        rec().record(Op::DrawElementsIndirect, {mode, type, uint64_t(reinterpret_cast<uintptr_t>(indirect))});
+    };
+#endif
+#ifdef GL_VERSION_4_3
+    inline void multiDrawArraysIndirect(GLenum mode, const void* indirect, GLsizei draws, GLsizei stride) {
+        (glMultiDrawArraysIndirect)(mode, indirect, draws, stride);
+        rec().record(Op::MultiDrawArraysIndirect, {mode, uint64_t(reinterpret_cast<uintptr_t>(indirect)),
+                                                   uint64_t(draws), uint64_t(stride)});
+    };
+    inline void multiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei draws,
+                                          GLsizei stride) {
+        (glMultiDrawElementsIndirect)(mode, type, indirect, draws, stride);
+        rec().record(Op::MultiDrawElementsIndirect, {mode, type, uint64_t(reinterpret_cast<uintptr_t>(indirect)),
+                                                     uint64_t(draws), uint64_t(stride)});
+    };
+#endif
+
+    inline void genFramebuffers(GLsizei n, GLuint* names) {
+        (glGenFramebuffers)(n, names);
+        rec().record(Op::GenFramebuffers, {uint64_t(n)}, names, sizeof(GLuint) * n);
+    };
+    inline void deleteFramebuffers(GLsizei n, const GLuint* names) {
+        rec().record(Op::DeleteFramebuffers, {uint64_t(n)}, names, sizeof(GLuint) * n);
+        (glDeleteFramebuffers)(n, names);
+    };
+    inline void bindFramebuffer(GLenum target, GLuint name) {
+        (glBindFramebuffer)(target, name);
+        rec().record(Op::BindFramebuffer, {target, name});
+    };
+    inline void framebufferTexture2D(GLenum target, GLenum attachment, GLenum texture_target, GLuint texture,
+                                     GLint level) {
+        (glFramebufferTexture2D)(target, attachment, texture_target, texture, level);
+        rec().record(Op::FramebufferTexture2D, {target, attachment, texture_target, texture, uint64_t(level)});
+    };
+    inline void framebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffer_target,
+                                        GLuint renderbuffer) {
+        (glFramebufferRenderbuffer)(target, attachment, renderbuffer_target, renderbuffer);
+        rec().record(Op::FramebufferRenderbuffer, {target, attachment, renderbuffer_target, renderbuffer});
+    };
+    inline void genRenderbuffers(GLsizei n, GLuint* names) {
+        (glGenRenderbuffers)(n, names);
+        rec().record(Op::GenRenderbuffers, {uint64_t(n)}, names, sizeof(GLuint) * n);
+    };
+    inline void deleteRenderbuffers(GLsizei n, const GLuint* names) {
+        rec().record(Op::DeleteRenderbuffers, {uint64_t(n)}, names, sizeof(GLuint) * n);
+        (glDeleteRenderbuffers)(n, names);
+    };
+    inline void bindRenderbuffer(GLenum target, GLuint name) {
+        (glBindRenderbuffer)(target, name);
+        rec().record(Op::BindRenderbuffer, {target, name});
+    };
+    inline void renderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internal_format,
+                                               GLsizei width, GLsizei height) {
+        (glRenderbufferStorageMultisample)(target, samples, internal_format, width, height);
+        rec().record(Op::RenderbufferStorageMultisample, {target, uint64_t(samples), internal_format,
+                                                          uint64_t(width), uint64_t(height)});
+    };
+    inline void blitFramebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1, GLint dst_x0, GLint dst_y0,
+                                GLint dst_x1, GLint dst_y1, GLbitfield mask, GLenum filter) {
+        (glBlitFramebuffer)(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1, mask, filter);
+        rec().record(Op::BlitFramebuffer, {uint64_t(int64_t(src_x0)), uint64_t(int64_t(src_y0)),
+                                           uint64_t(int64_t(src_x1)), uint64_t(int64_t(src_y1)),
+                                           uint64_t(int64_t(dst_x0)), uint64_t(int64_t(dst_y0)),
+                                           uint64_t(int64_t(dst_x1)), uint64_t(int64_t(dst_y1)), mask, filter});
+    };
+#ifdef GL_VERSION_4_3
+    inline void invalidateFramebuffer(GLenum target, GLsizei count, const GLenum* attachments) {
+        (glInvalidateFramebuffer)(target, count, attachments);
+        rec().record(Op::InvalidateFramebuffer, {target, uint64_t(count)}, attachments, sizeof(GLenum) * count);
+    };
+#endif
+    inline void depthMask(GLboolean flag) {
+        (glDepthMask)(flag);
+        rec().record(Op::DepthMask, {flag});
+    };
+    inline void colorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) {
+        (glColorMask)(r, g, b, a);
+        rec().record(Op::ColorMask, {r, g, b, a});
+    };
+    inline void uniform3fv(GLint location, GLsizei count, const GLfloat* values) {
+        (glUniform3fv)(location, count, values);
+        rec().record(Op::Uniform3fv, {uint64_t(int64_t(location)), uint64_t(count)}, values,
+                     3 * sizeof(GLfloat) * count);
+    };
+    inline void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) {
+        (glUniformMatrix4fv)(location, count, transpose, values);
+        rec().record(Op::UniformMatrix4fv, {uint64_t(int64_t(location)), uint64_t(count), transpose}, values,
+                     16 * sizeof(GLfloat) * count);
+    };
+
+    inline void genQueries(GLsizei n, GLuint* names) {
+        (glGenQueries)(n, names);
+        rec().record(Op::GenQueries, {uint64_t(n)}, names, sizeof(GLuint) * n);
+    };
+    inline void deleteQueries(GLsizei n, const GLuint* names) {
+        rec().record(Op::DeleteQueries, {uint64_t(n)}, names, sizeof(GLuint) * n);
+        (glDeleteQueries)(n, names);
+    };
+    inline void beginQuery(GLenum target, GLuint query) {
+        (glBeginQuery)(target, query);
+        rec().record(Op::BeginQuery, {target, query});
+    };
+    inline void endQuery(GLenum target) {
+        (glEndQuery)(target);
+        rec().record(Op::EndQuery, {target});
+    };
+    inline void queryCounter(GLuint query, GLenum target) {
+        (glQueryCounter)(query, target);
+        rec().record(Op::QueryCounter, {query, target});
+    };
+    inline void beginConditionalRender(GLuint query, GLenum mode) {
+        (glBeginConditionalRender)(query, mode);
+        rec().record(Op::BeginConditionalRender, {query, mode});
+    };
+    inline void endConditionalRender() {
+        (glEndConditionalRender)();
+        rec().record(Op::EndConditionalRender, {});
+    };
+
+    /* reading back, as Capture does, changes nothing a replay draws; writes through a mapping are not recorded */
+    inline void* mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        if (rec().active() && (access & GL_MAP_WRITE_BIT)) untraced("glMapBufferRange with GL_MAP_WRITE_BIT");
+        return (glMapBufferRange)(target, offset, length, access);
+    };
+};
+
+
+/* redirection; only when recording is compiled in, the replayer includes this header for the file format alone */
+#ifdef MYGL_TRACE
+#define glGenBuffers(...) gltrace::genBuffers(__VA_ARGS__)
+#define glDeleteBuffers(...) gltrace::deleteBuffers(__VA_ARGS__)
+#define glBindBuffer(...) gltrace::bindBuffer(__VA_ARGS__)
+#define glBufferData(...) gltrace::bufferData(__VA_ARGS__)
+#define glBufferSubData(...) gltrace::bufferSubData(__VA_ARGS__)
+#define glGenVertexArrays(...) gltrace::genVertexArrays(__VA_ARGS__)
+#define glDeleteVertexArrays(...) gltrace::deleteVertexArrays(__VA_ARGS__)
+#define glBindVertexArray(...) gltrace::bindVertexArray(__VA_ARGS__)
+#define glEnableVertexAttribArray(...) gltrace::enableVertexAttribArray(__VA_ARGS__)
+#define glVertexAttribPointer(...) gltrace::vertexAttribPointer(__VA_ARGS__)
+#define glGenTextures(...) gltrace::genTextures(__VA_ARGS__)
+#define glDeleteTextures(...) gltrace::deleteTextures(__VA_ARGS__)
+#define glBindTexture(...) gltrace::bindTexture(__VA_ARGS__)
+#define glActiveTexture(...) gltrace::activeTexture(__VA_ARGS__)
+#define glTexParameteri(...) gltrace::texParameteri(__VA_ARGS__)
+#define glPixelStorei(...) gltrace::pixelStorei(__VA_ARGS__)
+#define glTexImage2D(...) gltrace::texImage2D(__VA_ARGS__)
+#define glTexSubImage2D(...) gltrace::texSubImage2D(__VA_ARGS__)
+#define glCreateShader(...) gltrace::createShader(__VA_ARGS__)
+#define glShaderSource(...) gltrace::shaderSource(__VA_ARGS__)
+#define glCompileShader(...) gltrace::compileShader(__VA_ARGS__)
+#define glDeleteShader(...) gltrace::deleteShader(__VA_ARGS__)
+#define glCreateProgram(...) gltrace::createProgram(__VA_ARGS__)
+#define glAttachShader(...) gltrace::attachShader(__VA_ARGS__)
+#define glDetachShader(...) gltrace::detachShader(__VA_ARGS__)
+#define glLinkProgram(...) gltrace::linkProgram(__VA_ARGS__)
+#define glDeleteProgram(...) gltrace::deleteProgram(__VA_ARGS__)
+#define glUseProgram(...) gltrace::useProgram(__VA_ARGS__)
+#define glGetUniformLocation(...) gltrace::getUniformLocation(__VA_ARGS__)
+#define glUniform1i(...) gltrace::uniform1i(__VA_ARGS__)
+#define glUniform1f(...) gltrace::uniform1f(__VA_ARGS__)
+#define glUniform2f(...) gltrace::uniform2f(__VA_ARGS__)
+#define glClearColor(...) gltrace::clearColor(__VA_ARGS__)
+#define glClear(...) gltrace::clear(__VA_ARGS__)
+#define glViewport(...) gltrace::viewport(__VA_ARGS__)
+#define glEnable(...) gltrace::enable(__VA_ARGS__)
+#define glDisable(...) gltrace::disable(__VA_ARGS__)
+#define glDrawArrays(...) gltrace::drawArrays(__VA_ARGS__)
+#define glDrawArraysInstanced(...) gltrace::drawArraysInstanced(__VA_ARGS__)
+#define glDrawElements(...) gltrace::drawElements(__VA_ARGS__)
+#define glDrawElementsBaseVertex(...) gltrace::drawElementsBaseVertex(__VA_ARGS__)
+#define glDrawElementsInstancedBaseVertex(...) gltrace::drawElementsInstancedBaseVertex(__VA_ARGS__)
+#define glMultiDrawElementsBaseVertex(...) gltrace::multiDrawElementsBaseVertex(__VA_ARGS__)
+#ifdef GL_VERSION_4_0
+#define glDrawArraysIndirect(...) gltrace::drawArraysIndirect(__VA_ARGS__)
+#define glDrawElementsIndirect(...) gltrace::drawElementsIndirect(__VA_ARGS__)
+#endif
+#ifdef GL_VERSION_4_3
+#define glMultiDrawArraysIndirect(...) gltrace::multiDrawArraysIndirect(__VA_ARGS__)
+#define glMultiDrawElementsIndirect(...) gltrace::multiDrawElementsIndirect(__VA_ARGS__)
+#endif
+#define glGenFramebuffers(...) gltrace::genFramebuffers(__VA_ARGS__)
+#define glDeleteFramebuffers(...) gltrace::deleteFramebuffers(__VA_ARGS__)
+#define glBindFramebuffer(...) gltrace::bindFramebuffer(__VA_ARGS__)
+#define glFramebufferTexture2D(...) gltrace::framebufferTexture2D(__VA_ARGS__)
+#define glFramebufferRenderbuffer(...) gltrace::framebufferRenderbuffer(__VA_ARGS__)
+#define glGenRenderbuffers(...) gltrace::genRenderbuffers(__VA_ARGS__)
+#define glDeleteRenderbuffers(...) gltrace::deleteRenderbuffers(__VA_ARGS__)
+#define glBindRenderbuffer(...) gltrace::bindRenderbuffer(__VA_ARGS__)
+#define glRenderbufferStorageMultisample(...) gltrace::renderbufferStorageMultisample(__VA_ARGS__)
+#define glBlitFramebuffer(...) gltrace::blitFramebuffer(__VA_ARGS__)
+#ifdef GL_VERSION_4_3
+#define glInvalidateFramebuffer(...) gltrace::invalidateFramebuffer(__VA_ARGS__)
+#endif
+#define glDepthMask(...) gltrace::depthMask(__VA_ARGS__)
+#define glColorMask(...) gltrace::colorMask(__VA_ARGS__)
+#define glUniform3fv(...) gltrace::uniform3fv(__VA_ARGS__)
+#define glUniformMatrix4fv(...) gltrace::uniformMatrix4fv(__VA_ARGS__)
+#define glGenQueries(...) gltrace::genQueries(__VA_ARGS__)
+#define glDeleteQueries(...) gltrace::deleteQueries(__VA_ARGS__)
+#define glBeginQuery(...) gltrace::beginQuery(__VA_ARGS__)
+#define glEndQuery(...) gltrace::endQuery(__VA_ARGS__)
+#define glQueryCounter(...) gltrace::queryCounter(__VA_ARGS__)
+#define glBeginConditionalRender(...) gltrace::beginConditionalRender(__VA_ARGS__)
+#define glEndConditionalRender() gltrace::endConditionalRender()
+#define glMapBufferRange(...) gltrace::mapBufferRange(__VA_ARGS__)
+#endif
+
+
+#endif //_TRACE_HPP
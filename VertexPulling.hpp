@@ -0,0 +1,67 @@
+//
+// Created by pallas athena on 16/10/10.
+//
+
+#ifndef _VERTEX_PULLING_HPP
+#define _VERTEX_PULLING_HPP
+
+#include "myGL.hpp"
+
+
+/* bufferless regular polygons: the vertex shader derives each corner from gl_VertexID and each polygon's cell from
+ * gl_InstanceID, so nothing is generated on the cpu or uploaded. the program must declare the uniforms of
+ * HelloGL/polygon.vert; ColorAttribute/colored_polygon.vert adds the coloring of coloredTriangle(). gl calls require
+ * the owning context to be current. */
+class PolygonPulling {
+private:
+    GLuint m_program = 0;
+    GLuint m_vertexArray = 0; // empty; core profile needs one bound to draw
+    GLint m_radiusLocation = -1;
+    GLint m_anglesLocation = -1;
+    GLint m_gridSideLocation = -1;
+    GLint m_cellSizeLocation = -1;
+
+public:
+    PolygonPulling(){};
+
+    ~PolygonPulling() {
+        // gl objects can only be deleted with a current context; destroy() is the caller's duty
+        assert(this->m_vertexArray == 0);
+    };
+
+    PolygonPulling(const PolygonPulling&) = delete;
+    PolygonPulling& operator=(const PolygonPulling&) = delete;
+
+public:
+    void initialize(GLuint program) {
+        this->m_program = program;
+        this->m_radiusLocation = glGetUniformLocation(program, "radius");
+        this->m_anglesLocation = glGetUniformLocation(program, "angles");
+        this->m_gridSideLocation = glGetUniformLocation(program, "gridSide");
+        this->m_cellSizeLocation = glGetUniformLocation(program, "cellSize");
+        glGenVertexArrays(1, &this->m_vertexArray);
+    };
+
+    /* one polygon like regularPolygon(radius, angles) when grid_side is 0; otherwise one per cell of a grid covering
+     * the viewport, filled row by row, with radius relative to half a cell; instances defaults to the whole grid.
+     * leaves the program & VAO bound */
+    void draw(GLfloat radius, GLint angles, GLint grid_side = 0, GLsizei instances = 0) {
+        glUseProgram(this->m_program);
+        glUniform1f(this->m_radiusLocation, radius);
+        glUniform1i(this->m_anglesLocation, angles);
+        glUniform1i(this->m_gridSideLocation, grid_side);
+        glUniform1f(this->m_cellSizeLocation, grid_side > 0 ? 2.0f / grid_side : 2.0f);
+
+        glBindVertexArray(this->m_vertexArray);
+        if (instances == 0) instances = grid_side > 0 ? grid_side * grid_side : 1;
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, angles, instances);
+    };
+
+    void destroy() {
+        if (this->m_vertexArray) glDeleteVertexArrays(1, &this->m_vertexArray);
+        this->m_vertexArray = 0;
+    };
+};
+
+
+#endif //_VERTEX_PULLING_HPP
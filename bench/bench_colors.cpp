@@ -0,0 +1,17 @@
+#include "myGL.hpp"
+#include "ColorAttribute/Geometry.hpp"
+
+#include <benchmark/benchmark.h>
+
+
+/* coloredTriangle() including the container it fills; single and double precision */
+template <typename T> static void BM_coloredTriangle(benchmark::State& state) {
+    for (auto _ : state) {
+        std::vector<T> vertex_data;
+        auto header = coloredTriangle(T(0.8), vertex_data);
+        benchmark::DoNotOptimize(header.colorDataOffset());
+        benchmark::DoNotOptimize(vertex_data.data());
+    }
+}
+BENCHMARK_TEMPLATE(BM_coloredTriangle, GLfloat);
+BENCHMARK_TEMPLATE(BM_coloredTriangle, GLdouble);
@@ -0,0 +1,44 @@
+#include "myGL.hpp"
+#include "HelloGL/Geometry.hpp"
+
+#include <benchmark/benchmark.h>
+
+
+/* regularPolygon() from 3 up to 4096 angles */
+static void BM_regularPolygon(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(regularPolygon(0.8f, int(state.range(0))));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_regularPolygon)->RangeMultiplier(8)->Range(3, 4096);
+
+
+/* offset & stride math of VertexBufferHeader, as done once per attribute when setting up a VAO. the inputs go
+ * through DoNotOptimize every iteration so that the construction is not folded into constants */
+static void BM_VertexBufferHeader(benchmark::State& state) {
+    std::vector<GLfloat> vertex_data(8 * 6);
+    int vertices_count = 6, position_dimension = 3, normal_dimension = 0, color_dimension = 3;
+    int uv_dimension = int(state.range(0));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(vertex_data.data());
+        benchmark::DoNotOptimize(vertices_count);
+        benchmark::DoNotOptimize(position_dimension);
+        benchmark::DoNotOptimize(normal_dimension);
+        benchmark::DoNotOptimize(uv_dimension);
+        benchmark::DoNotOptimize(color_dimension);
+        benchmark::ClobberMemory();
+
+        VertexBufferHeader<GLfloat> header(vertex_data, vertices_count, position_dimension, normal_dimension,
+                                           uv_dimension, color_dimension);
+        benchmark::DoNotOptimize(header.positionDataOffset());
+        benchmark::DoNotOptimize(header.normalDataOffset());
+        benchmark::DoNotOptimize(header.uvDataOffset());
+        benchmark::DoNotOptimize(header.colorDataOffset());
+        benchmark::DoNotOptimize(header.stride());
+        benchmark::DoNotOptimize(header.bufferSize());
+        benchmark::DoNotOptimize(header.dataType());
+    }
+}
+BENCHMARK(BM_VertexBufferHeader)->Arg(2);
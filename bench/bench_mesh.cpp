@@ -0,0 +1,68 @@
+#include "myGL.hpp"
+#include "MeshFile.hpp"
+#include "MeshConvert/TextMesh.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <unistd.h>
+
+
+/* a grid of state.range(0) triangles written as obj, ply & mesh file; peak memory needs separate processes, see
+ * "MeshConvert bench" for that and for 10M triangles */
+static const std::string obj_file = "bench_mesh.obj";
+static const std::string ply_file = "bench_mesh.ply";
+static const std::string mesh_file = "bench_mesh.mesh";
+
+static void writeGrid(size_t triangles) {
+    TextMesh grid = gridMesh(triangles);
+    writeObjMesh(obj_file, grid);
+    writePlyMesh(ply_file, grid);
+    writeMeshFile(mesh_file, grid.header(), grid.indices, grid.submeshes);
+}
+
+static void removeGrid() {
+    std::remove(obj_file.c_str());
+    std::remove(ply_file.c_str());
+    std::remove(mesh_file.c_str());
+}
+
+static void BM_readObjMesh(benchmark::State& state) {
+    writeGrid(size_t(state.range(0)));
+    for (auto _ : state) {
+        TextMesh mesh = readObjMesh(obj_file);
+        benchmark::DoNotOptimize(mesh.vertices.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+    removeGrid();
+}
+BENCHMARK(BM_readObjMesh)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_readPlyMesh(benchmark::State& state) {
+    writeGrid(size_t(state.range(0)));
+    for (auto _ : state) {
+        TextMesh mesh = readPlyMesh(ply_file);
+        benchmark::DoNotOptimize(mesh.vertices.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+    removeGrid();
+}
+BENCHMARK(BM_readPlyMesh)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+/* map & read every page once, as the upload would; the page cache is warm as it is for the text files */
+static void BM_MappedMesh(benchmark::State& state) {
+    writeGrid(size_t(state.range(0)));
+    const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    for (auto _ : state) {
+        MappedMesh mesh(mesh_file);
+        const MeshFileHeader& header = mesh.header();
+        const unsigned char* vertices = reinterpret_cast<const unsigned char*>(mesh.vertexData());
+        const unsigned char* indices = reinterpret_cast<const unsigned char*>(mesh.indexData());
+        unsigned long checksum = 0;
+        for (size_t i = 0; i < header.vertexDataSize; i += page) checksum += vertices[i];
+        for (size_t i = 0; i < header.indexDataSize; i += page) checksum += indices[i];
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+    removeGrid();
+}
+BENCHMARK(BM_MappedMesh)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
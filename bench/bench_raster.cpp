@@ -0,0 +1,48 @@
+#include "myGL.hpp"
+#include "SoftRaster.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+
+
+/* one triangle with position & color per cell of a side x side grid, interleaved like VertexBufferHeader */
+static std::vector<GLfloat> gridTriangles(int side) {
+    std::vector<GLfloat> vertices;
+    const GLfloat cell = 2.0f / side;
+
+    for (int i = 0; i < side * side; ++i) {
+        GLfloat x = -1.0f + cell * (i % side), y = -1.0f + cell * (i / side);
+        std::vector<GLfloat> triangle = {
+                x,        y,        0.0f, 1.0f, 0.0f, 0.0f,
+                x + cell, y,        0.0f, 0.0f, 1.0f, 0.0f,
+                x,        y + cell, 0.0f, 0.0f, 0.0f, 1.0f
+        };
+        vertices.insert(vertices.end(), triangle.begin(), triangle.end());
+    }
+
+    return vertices;
+}
+
+/* 1080p frame of side^2 color-interpolated triangles covering half the screen; args: grid side, threads */
+static void BM_SoftRasterizer(benchmark::State& state) {
+    const int side = int(state.range(0));
+    std::vector<GLfloat> vertex_data = gridTriangles(side);
+    VertexBufferHeader<GLfloat> header(vertex_data, side * side * 3, 3, 0, 0, 3);
+    SoftVertexStream stream = softVertexStream(header, header.colorDataOffset(), header.colorVecDimension());
+
+    SoftRasterizer rasterizer(unsigned(state.range(1)));
+    SoftFramebuffer framebuffer(1920, 1080);
+
+    for (auto _ : state) {
+        rasterizer.begin(framebuffer, 0, 0, framebuffer.width, framebuffer.height);
+        rasterizer.drawArrays(stream, 0, header.verticesCount(), SoftShading::Color);
+        rasterizer.flush();
+    }
+
+    state.counters["Mtri/s"] = benchmark::Counter(rasterizer.trianglesCount() / 1e6, benchmark::Counter::kIsRate);
+    state.counters["Mpix/s"] = benchmark::Counter(rasterizer.pixelsCount() / 1e6, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_SoftRasterizer)
+        ->ArgsProduct({{8, 64, 256}, {1, 2, 4, 8}})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
@@ -0,0 +1,23 @@
+#include "myGL.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+
+
+/* readShaderFile() on generated sources of 1 KiB up to 1 MiB */
+static void BM_readShaderFile(benchmark::State& state) {
+    const std::string file = "bench_shader_" + std::to_string(state.range(0)) + ".glsl";
+    {
+        std::ofstream writer(file);
+        std::string line = "    gl_Position = vec4(position.xy + offset * cellSize, position.z, 1.0);\n";
+        for (int64_t written = 0; written < state.range(0); written += line.size()) writer << line;
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(readShaderFile(file));
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * state.range(0));
+
+    std::remove(file.c_str());
+}
+BENCHMARK(BM_readShaderFile)->RangeMultiplier(8)->Range(1 << 10, 1 << 20);
@@ -0,0 +1,35 @@
+#include "myGL.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+
+#ifndef MYGL_NO_OPENCV
+
+/* decode & flip stage of loadRgbTexture(), i.e. readRgbImage(), on square png images of 64 up to 4096 pixels */
+static void BM_readRgbImage(benchmark::State& state) {
+    const int size = int(state.range(0));
+    const std::string file = "bench_texture_" + std::to_string(size) + ".png";
+    {
+        // deterministic gradient; compresses like a photo rather than like a flat color
+        cv::Mat image(size, size, CV_8UC3);
+        for (int row = 0; row < size; ++row) {
+            unsigned char* pixel = image.ptr(row);
+            for (int column = 0; column < size; ++column, pixel += 3) {
+                pixel[0] = (unsigned char)(row * 7 + column);
+                pixel[1] = (unsigned char)(row ^ column);
+                pixel[2] = (unsigned char)(column * 3);
+            }
+        }
+        cv::imwrite(file, image);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(readRgbImage(file).data);
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * size * size * 3);
+
+    std::remove(file.c_str());
+}
+BENCHMARK(BM_readRgbImage)->RangeMultiplier(4)->Range(64, 4096)->Unit(benchmark::kMillisecond);
+
+#endif
@@ -1,5 +1,6 @@
 #include "../myGL.hpp"
 #include "../Context.hpp"
+#include "../Resource.hpp"
 
 
 /* Constants. */
@@ -29,20 +30,18 @@ auto header = VertexBufferHeader<GLfloat>(vertex_data, 6, 3, 0, 2, 3);
 class Window : public GLContext {
 
 private:
-    GLuint vertex_buffer; /* VBO object */
+    ResourcePool resources; /* pooled gl objects */
+    PooledBuffer vertex_buffer; /* VBO object */
     GLuint vertex_array_color; /* VAO objects */
     GLuint vertex_array_texture;
     GLuint program_id_color; /* shaders */
     GLuint program_id_texture;
-    GLuint texture; /* texture */
+    PooledTexture texture; /* texture */
 
     void initialize() {
         /* create VBO object */
-        glGenBuffers(1, &vertex_buffer);
-        {
-            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-            glBufferData(GL_ARRAY_BUFFER, header.bufferSize(), header.bufferData(), GL_STATIC_DRAW);
-        }
+        vertex_buffer = resources.acquireBuffer(ResourceCategory::Vertex, header.bufferSize(), header.bufferData());
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer.name);
 
         /* two VAO objects; one with color but no texture; the other with texture but no color */
         glGenVertexArrays(1, &vertex_array_texture);
@@ -103,8 +102,20 @@ private:
         program_id_color = compileShaders(vertex_shader_file_color, fragment_shader_file_color);
         program_id_texture = compileShaders(vertex_shader_file_texture, fragment_shader_file_texture);
 
-        /* create texture */
-        texture = loadRgbTexture(texture_image);
+        /* create texture; storage from the pool, pixels from OpenCV */
+        cv::Mat image = readRgbImage(texture_image);
+        texture = resources.acquireTexture2D(GL_RGB8, image.cols, image.rows, GL_BGR, GL_UNSIGNED_BYTE);
+        {
+            glBindTexture(GL_TEXTURE_2D, texture.name);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+            setUnpackLayout(image);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.cols, image.rows, GL_BGR, GL_UNSIGNED_BYTE, image.data);
+        }
 
         /* Apply the shader */
         glUseProgram(program_id_color);
@@ -130,13 +141,16 @@ private:
 
     void destroy() {
         /* Destroy gl objects */
-        glDeleteBuffers(1, &vertex_buffer);
+        resources.releaseBuffer(vertex_buffer);
         glDeleteVertexArrays(1, &vertex_array_color);
         glDeleteVertexArrays(1, &vertex_array_texture);
         glDeleteProgram(program_id_color);
         glDeleteProgram(program_id_texture);
 
-        glDeleteTextures(1, &texture);
+        resources.releaseTexture(texture);
+
+        resources.statistics().report(std::cout);
+        resources.clear();
     };
 };
 
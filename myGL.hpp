@@ -5,7 +5,18 @@
 #define _MYGL_HPP
 
 
-#include <OpenGL/gl3.h>
+#ifdef __APPLE__
+# include <OpenGL/gl3.h>
+#else
+# define GL_GLEXT_PROTOTYPES
+# include <GL/glcorearb.h>
+# define GLFW_INCLUDE_NONE // core profile functions come from glcorearb.h; keep glfw3.h from including gl.h
+#endif
+
+/* gl call recording; must come before any gl call below. see Trace.hpp */
+#ifdef MYGL_TRACE
+#include "Trace.hpp"
+#endif
 
 #include <cassert>
 #include <fstream>
@@ -13,20 +24,25 @@
 #include <iostream>
 #include <vector>
 
+#include "Timeline.hpp"
+
 /* avoid warning "gl.h and gl3.h are both included" */
 #ifdef __APPLE__
 # define __gl_h_
 # define GL_DO_NOT_WARN_IF_MULTI_GL_VERSION_HEADERS_INCLUDED
 #endif
 
-/*include OpenCV libraries.*/
+/*include OpenCV libraries; define MYGL_NO_OPENCV to build without texture loading.*/
+#ifndef MYGL_NO_OPENCV
 #include <cassert>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#endif
 
 
 /* read shader file */
-std::string readShaderFile(const std::string &file) {
+inline std::string readShaderFile(const std::string &file) {
+    timeline::Zone zone("readShaderFile", file);
 
     std::ifstream reader(file);
     std::stringstream source;
@@ -42,12 +58,9 @@ std::string readShaderFile(const std::string &file) {
     return source.str();
 }
 
-/* compile shaders */
-GLuint compileShaders(const std::string &vertexShaderFile, const std::string &fragmentShaderFile) {
-
-    // Read our shaders into the appropriate buffers
-    std::string vertexSource = readShaderFile(vertexShaderFile); // Get source code for vertex shader.
-    std::string fragmentSource = readShaderFile(fragmentShaderFile); // Get source code for fragment shader.
+/* compile shaders from source code */
+inline GLuint compileShaderSources(const std::string &vertexSource, const std::string &fragmentSource) {
+    timeline::Zone zone("compileShaderSources");
 
     // Create an empty vertex shader handle
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -159,6 +172,17 @@ GLuint compileShaders(const std::string &vertexShaderFile, const std::string &fr
     return program;
 }
 
+/* compile shaders */
+inline GLuint compileShaders(const std::string &vertexShaderFile, const std::string &fragmentShaderFile) {
+    timeline::Zone zone("compileShaders", vertexShaderFile);
+
+    // Read our shaders into the appropriate buffers
+    std::string vertexSource = readShaderFile(vertexShaderFile); // Get source code for vertex shader.
+    std::string fragmentSource = readShaderFile(fragmentShaderFile); // Get source code for fragment shader.
+
+    return compileShaderSources(vertexSource, fragmentSource);
+}
+
 
 /* vertex buffer data header; itself doesn't contain data */
 /* data are arranged as pattern of "PNTCPNTCPNTC" (position-normal-texture corrds-color) */
@@ -249,8 +273,10 @@ public:
 };
 
 
-/* load & generate texture map with OpenCV libraries */
-GLuint loadRgbTexture(const std::string &imageFile) {
+#ifndef MYGL_NO_OPENCV
+/* decode an image file with OpenCV libraries into BGR rows ordered bottom-up, as opengl expects */
+inline cv::Mat readRgbImage(const std::string &imageFile) {
+    timeline::Zone zone("readRgbImage", imageFile);
     // since opengl deprecated GL_LUMINANCE for greyscale picture, here force to load image with RGB format;
     // load image with alpha channel pls. call another function
     cv::Mat cv_image = cv::imread(imageFile, CV_LOAD_IMAGE_COLOR);
@@ -258,24 +284,37 @@ GLuint loadRgbTexture(const std::string &imageFile) {
     // assertion to avoid potential exceptions
     assert(cv_image.type() == CV_8UC3);
 
+    // reverse the pixel order for opencv matrix coordinates at top-left corner which opposite to opengl's behavior.
+    cv::Mat cv_image_reversed(cv_image.size(), cv_image.type());
+    cv::flip(cv_image, cv_image_reversed, 0);
+
+    return cv_image_reversed;
+};
+
+/* pixel unpack state for uploading an OpenCV image with glTexImage2D / glTexSubImage2D */
+inline void setUnpackLayout(const cv::Mat& cv_image_reversed) {
     // opengl default regards the bytes numbers of each row as multiple of 4; if not the value of unpack alignment
     // bytes must be set to 1; however, use 4 as possible as you can for fast processing
     const GLint GL_DEFAULT_PIXEL_ALIGNMENT = 4, GL_MIN_PIXEL_ALIGNMENT = 1;
     glPixelStorei(
             GL_UNPACK_ALIGNMENT,
-            cv_image.step[0] % GL_DEFAULT_PIXEL_ALIGNMENT == 0 ? GL_DEFAULT_PIXEL_ALIGNMENT : GL_MIN_PIXEL_ALIGNMENT
+            cv_image_reversed.step[0] % GL_DEFAULT_PIXEL_ALIGNMENT == 0 ?
+            GL_DEFAULT_PIXEL_ALIGNMENT : GL_MIN_PIXEL_ALIGNMENT
     );
 
     // start pointer stride of each row data; may note be column numbers since opencv doesn't necessarily store row
     // data continuously.
     glPixelStorei(
             GL_UNPACK_ROW_LENGTH,
-            (GLint)(cv_image.step[0] / cv_image.elemSize())
+            (GLint)(cv_image_reversed.step[0] / cv_image_reversed.elemSize())
     );
+};
 
-    // reverse the pixel order for opencv matrix coordinates at top-left corner which opposite to opengl's behavior.
-    cv::Mat cv_image_reversed(cv_image.size(), cv_image.type());
-    cv::flip(cv_image, cv_image_reversed, 0);
+/* load & generate texture map with OpenCV libraries */
+inline GLuint loadRgbTexture(const std::string &imageFile) {
+    timeline::Zone zone("loadRgbTexture", imageFile);
+    cv::Mat cv_image_reversed = readRgbImage(imageFile);
+    setUnpackLayout(cv_image_reversed);
 
     // generate texture object
     GLuint texture_id;
@@ -303,6 +342,7 @@ GLuint loadRgbTexture(const std::string &imageFile) {
 
     return texture_id;
 };
+#endif
 
 
 #endif
@@ -0,0 +1,64 @@
+#include "myGL.hpp"
+#include "MeshBuffer.hpp"
+
+#include <gtest/gtest.h>
+
+
+/* by value; gtest would bind the class constant to a reference, which needs a definition */
+static const GLuint invalid = BuddyAllocator::INVALID_OFFSET;
+
+TEST(BuddyAllocator, RoundsCapacityUpToPowerOfTwo) {
+    BuddyAllocator allocator(100);
+    EXPECT_EQ(allocator.capacity(), 128u);
+    EXPECT_EQ(allocator.largestFreeBlock(), 128u);
+    EXPECT_EQ(allocator.usedUnits(), 0u);
+}
+
+TEST(BuddyAllocator, SplitsDownToTheRequestedOrder) {
+    BuddyAllocator allocator(16);
+    EXPECT_EQ(allocator.allocate(1), 0u);
+
+    // 16 -> 8 + 8 -> 4 + 4 -> 2 + 2 -> 1 + 1; the upper halves stay free
+    EXPECT_EQ(allocator.usedUnits(), 1u);
+    EXPECT_EQ(allocator.largestFreeBlock(), 8u);
+    EXPECT_EQ(allocator.allocate(1), 1u);
+    EXPECT_EQ(allocator.allocate(2), 2u);
+    EXPECT_EQ(allocator.allocate(4), 4u);
+    EXPECT_EQ(allocator.allocate(8), 8u);
+    EXPECT_EQ(allocator.usedUnits(), 16u);
+    EXPECT_EQ(allocator.allocate(1), invalid);
+}
+
+TEST(BuddyAllocator, MergesFreedBuddies) {
+    BuddyAllocator allocator(16);
+    GLuint a = allocator.allocate(3); // rounded to 4
+    GLuint b = allocator.allocate(4);
+    GLuint c = allocator.allocate(8);
+    EXPECT_EQ(a, 0u);
+    EXPECT_EQ(b, 4u);
+    EXPECT_EQ(c, 8u);
+    EXPECT_EQ(allocator.usedUnits(), 16u);
+    EXPECT_FLOAT_EQ(allocator.internalFragmentation(), 1.0f / 16.0f);
+
+    // a's buddy is still in use; no merge yet
+    allocator.free(a, 3);
+    EXPECT_EQ(allocator.largestFreeBlock(), 4u);
+    allocator.free(c, 8);
+    EXPECT_EQ(allocator.largestFreeBlock(), 8u);
+    EXPECT_FLOAT_EQ(allocator.externalFragmentation(), 1.0f - 8.0f / 12.0f);
+
+    // 0..4 + 4..8 -> 0..8, + 8..16 -> the whole range again
+    allocator.free(b, 4);
+    EXPECT_EQ(allocator.usedUnits(), 0u);
+    EXPECT_EQ(allocator.largestFreeBlock(), 16u);
+    EXPECT_FLOAT_EQ(allocator.externalFragmentation(), 0.0f);
+    EXPECT_EQ(allocator.allocate(16), 0u);
+}
+
+TEST(BuddyAllocator, RejectsOversizedRequests) {
+    BuddyAllocator allocator(16);
+    EXPECT_EQ(allocator.allocate(17), invalid);
+    EXPECT_EQ(allocator.allocate(0xFFFFFFFFu), invalid);
+    EXPECT_EQ(allocator.usedUnits(), 0u);
+    EXPECT_EQ(allocator.allocate(16), 0u);
+}
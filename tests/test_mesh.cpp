@@ -0,0 +1,132 @@
+#include "myGL.hpp"
+#include "MeshFile.hpp"
+#include "MeshConvert/TextMesh.hpp"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+
+
+/* text files written by the tests; removed again by each test */
+static void writeText(const std::string& file, const std::string& text) {
+    FILE* out = std::fopen(file.c_str(), "wb");
+    ASSERT_NE(out, nullptr);
+    std::fwrite(text.data(), 1, text.size(), out);
+    std::fclose(out);
+}
+
+/* vertex data of every triangle corner; independent of how the vertices are numbered */
+static std::vector<GLfloat> corners(const TextMesh& mesh) {
+    const size_t stride = size_t(mesh.stride());
+    std::vector<GLfloat> corners;
+    for (GLuint index : mesh.indices) {
+        corners.insert(corners.end(), mesh.vertices.begin() + stride * index, mesh.vertices.begin() + stride * (index + 1));
+    }
+    return corners;
+}
+
+/* text files hold %g, six significant digits */
+static void expectNear(const std::vector<GLfloat>& actual, const std::vector<GLfloat>& expected) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) EXPECT_NEAR(actual[i], expected[i], 1e-5f) << "at " << i;
+}
+
+/* convert to a mesh file as MeshConvert does, map it and compare with the parsed mesh */
+static void expectRoundTrip(const TextMesh& mesh, const std::string& file) {
+    writeMeshFile(file, mesh.header(), mesh.indices, mesh.submeshes);
+    {
+        MappedMesh mapped(file);
+        const MeshFileHeader& header = mapped.header();
+        ASSERT_EQ(header.verticesCount, uint32_t(mesh.verticesCount));
+        ASSERT_EQ(header.indicesCount, mesh.indices.size());
+        ASSERT_EQ(header.submeshesCount, mesh.submeshes.size());
+        EXPECT_EQ(header.positionVecDimension, mesh.positionVecDimension);
+        EXPECT_EQ(header.normalVecDimension, mesh.normalVecDimension);
+        EXPECT_EQ(header.uvVecDimension, mesh.uvVecDimension);
+        EXPECT_EQ(header.colorVecDimension, mesh.colorVecDimension);
+
+        EXPECT_EQ(std::vector<GLfloat>(mapped.vertexData(), mapped.vertexData() + mesh.vertices.size()),
+                  mesh.vertices);
+        EXPECT_EQ(std::vector<GLuint>(mapped.indexData(), mapped.indexData() + mesh.indices.size()), mesh.indices);
+        for (uint32_t i = 0; i < header.submeshesCount; ++i) {
+            EXPECT_EQ(mapped.submeshes()[i].firstIndex, mesh.submeshes[i].firstIndex);
+            EXPECT_EQ(mapped.submeshes()[i].indicesCount, mesh.submeshes[i].indicesCount);
+        }
+    }
+    std::remove(file.c_str());
+}
+
+
+TEST(TextMesh, ObjKeepsFirstVertexColor) {
+    writeText("test_color.obj", "v 0 0 0 1 0 0\n"
+                                "v 1 0 0\n"
+                                "v 0 1 0 0 0 1\n"
+                                "f 1 2 3\n");
+    TextMesh mesh = readObjMesh("test_color.obj");
+    std::remove("test_color.obj");
+
+    ASSERT_EQ(mesh.verticesCount, 3);
+    ASSERT_EQ(mesh.colorVecDimension, 3);
+    const std::vector<GLfloat> expected = {0, 0, 0, 1, 0, 0,
+                                           1, 0, 0, 1, 1, 1, // uncolored vertices are white
+                                           0, 1, 0, 0, 0, 1};
+    EXPECT_EQ(mesh.vertices, expected);
+    expectRoundTrip(mesh, "test_color.mesh");
+}
+
+TEST(TextMesh, ObjLaterColorPadsEarlierVerticesWhite) {
+    writeText("test_pad.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0 0.5 0.5 0.5\nf 1 2 3\n");
+    TextMesh mesh = readObjMesh("test_pad.obj");
+    std::remove("test_pad.obj");
+
+    const std::vector<GLfloat> expected = {0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 0, 1, 0, 0.5f, 0.5f, 0.5f};
+    EXPECT_EQ(mesh.vertices, expected);
+}
+
+TEST(TextMesh, ObjRoundTrip) {
+    TextMesh grid = gridMesh(200);
+    writeObjMesh("test_grid.obj", grid);
+    TextMesh mesh = readObjMesh("test_grid.obj");
+    std::remove("test_grid.obj");
+
+    // vertices are numbered in order of first use
+    EXPECT_EQ(mesh.verticesCount, grid.verticesCount);
+    EXPECT_EQ(mesh.stride(), grid.stride());
+    expectNear(corners(mesh), corners(grid));
+    expectRoundTrip(mesh, "test_grid_obj.mesh");
+}
+
+TEST(TextMesh, PlyRoundTrip) {
+    TextMesh grid = gridMesh(200);
+    writePlyMesh("test_grid.ply", grid);
+    TextMesh mesh = readPlyMesh("test_grid.ply");
+    std::remove("test_grid.ply");
+
+    EXPECT_EQ(mesh.verticesCount, grid.verticesCount);
+    EXPECT_EQ(mesh.indices, grid.indices);
+    EXPECT_EQ(mesh.stride(), grid.stride());
+    expectNear(corners(mesh), corners(grid));
+    expectRoundTrip(mesh, "test_grid_ply.mesh");
+}
+
+TEST(TextMeshDeathTest, ObjRejectsOutOfRangeFace) {
+    writeText("test_range.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 7\n");
+    EXPECT_EXIT(readObjMesh("test_range.obj"), ::testing::ExitedWithCode(EXIT_FAILURE), "face index out of range");
+    std::remove("test_range.obj");
+}
+
+TEST(TextMeshDeathTest, PlyRejectsOutOfRangeFace) {
+    writeText("test_range.ply", "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\nproperty float y\n"
+                                "property float z\nelement face 1\nproperty list uchar uint vertex_indices\n"
+                                "end_header\n0 0 0\n1 0 0\n0 1 0\n3 0 1 7\n");
+    EXPECT_EXIT(readPlyMesh("test_range.ply"), ::testing::ExitedWithCode(EXIT_FAILURE), "face index out of range");
+    std::remove("test_range.ply");
+}
+
+TEST(MappedMeshDeathTest, RejectsSubmeshOutOfRange) {
+    TextMesh grid = gridMesh(8);
+    std::vector<MeshSubmesh> submeshes = {MeshSubmesh{3, uint32_t(grid.indices.size()), 0,
+                                                      uint32_t(grid.verticesCount)}};
+    writeMeshFile("test_submesh.mesh", grid.header(), grid.indices, submeshes);
+    EXPECT_EXIT(MappedMesh("test_submesh.mesh"), ::testing::ExitedWithCode(EXIT_FAILURE), "submesh 0 out of range");
+    std::remove("test_submesh.mesh");
+}
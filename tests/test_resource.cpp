@@ -0,0 +1,72 @@
+#include "myGL.hpp"
+#include "Resource.hpp"
+
+#include <gtest/gtest.h>
+
+
+/* by value; gtest would bind the class constant to a reference, which needs a definition */
+static const GLsizeiptr min_class = ResourcePool::MIN_BUFFER_CLASS;
+
+TEST(ResourcePool, SizeClassesArePowersOfTwo) {
+    EXPECT_EQ(min_class, 256);
+    EXPECT_EQ(ResourcePool::sizeClass(0), min_class);
+    EXPECT_EQ(ResourcePool::sizeClass(1), min_class);
+    EXPECT_EQ(ResourcePool::sizeClass(256), 256);
+    EXPECT_EQ(ResourcePool::sizeClass(257), 512);
+    EXPECT_EQ(ResourcePool::sizeClass(1000), 1024);
+    EXPECT_EQ(ResourcePool::sizeClass(1 << 20), 1 << 20);
+    EXPECT_EQ(ResourcePool::sizeClass((1 << 20) + 1), 1 << 21);
+}
+
+TEST(ResourcePool, TexelSizeFollowsTheInternalFormat) {
+    EXPECT_EQ(ResourcePool::texelSize(GL_R8), 1);
+    EXPECT_EQ(ResourcePool::texelSize(GL_RGB8), 3);
+    EXPECT_EQ(ResourcePool::texelSize(GL_RGBA8), 4);
+    EXPECT_EQ(ResourcePool::texelSize(GL_RGBA16F), 8);
+    EXPECT_EQ(ResourcePool::texelSize(GL_RGBA32F), 16);
+}
+
+TEST(ResourceStatistics, CountsAllocatedAndInUseBytes) {
+    ResourceStatistics statistics;
+    // what the pool does for two new buffers, then a release and a recycled acquisition of the first
+    statistics.allocate(ResourceCategory::Vertex, 256);
+    statistics.acquire(ResourceCategory::Vertex, 256, false);
+    statistics.allocate(ResourceCategory::Index, 1024);
+    statistics.acquire(ResourceCategory::Index, 1024, false);
+    EXPECT_EQ(statistics.allocated(ResourceCategory::Vertex), 256);
+    EXPECT_EQ(statistics.inUse(ResourceCategory::Index), 1024);
+    EXPECT_EQ(statistics.totalAllocated(), 256 + 1024);
+
+    statistics.release(ResourceCategory::Vertex, 256);
+    EXPECT_EQ(statistics.inUse(ResourceCategory::Vertex), 0);
+    EXPECT_EQ(statistics.allocated(ResourceCategory::Vertex), 256); // parked in the pool, still allocated
+    statistics.acquire(ResourceCategory::Vertex, 256, true);
+
+    EXPECT_EQ(statistics.objectsCreated(), 2u);
+    EXPECT_EQ(statistics.objectsRecycled(), 1u);
+    EXPECT_EQ(statistics.inUsePeak(ResourceCategory::Vertex), 256);
+}
+
+TEST(ResourceStatistics, KeepsPeaksAfterFree) {
+    ResourceStatistics statistics;
+    statistics.allocate(ResourceCategory::Texture, 4096);
+    statistics.acquire(ResourceCategory::Texture, 4096, false);
+    statistics.allocate(ResourceCategory::Uniform, 512);
+    statistics.acquire(ResourceCategory::Uniform, 512, false);
+
+    // released and trimmed
+    statistics.release(ResourceCategory::Texture, 4096);
+    statistics.free(ResourceCategory::Texture, 4096);
+    EXPECT_EQ(statistics.allocated(ResourceCategory::Texture), 0);
+    EXPECT_EQ(statistics.inUse(ResourceCategory::Texture), 0);
+    EXPECT_EQ(statistics.allocatedPeak(ResourceCategory::Texture), 4096);
+    EXPECT_EQ(statistics.inUsePeak(ResourceCategory::Texture), 4096);
+    EXPECT_EQ(statistics.totalAllocated(), 512);
+    EXPECT_EQ(statistics.totalAllocatedPeak(), 4096 + 512);
+
+    // a later allocation below the peak leaves it as it is
+    statistics.allocate(ResourceCategory::Texture, 1024);
+    EXPECT_EQ(statistics.totalAllocatedPeak(), 4096 + 512);
+    EXPECT_EQ(statistics.objectsCreated(), 3u);
+    EXPECT_EQ(statistics.objectsRecycled(), 0u);
+}
@@ -0,0 +1,180 @@
+#include "myGL.hpp"
+#include "Trace.hpp"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <vector>
+
+
+/* a trace file of the header followed by raw record bytes */
+static void writeTrace(const std::string& file, const std::vector<unsigned char>& records) {
+    gltrace::FileHeader header;
+    std::memcpy(header.magic, gltrace::MAGIC, sizeof(gltrace::MAGIC));
+    header.version = gltrace::VERSION;
+    FILE* out = std::fopen(file.c_str(), "wb");
+    ASSERT_NE(out, nullptr);
+    std::fwrite(&header, 1, sizeof(header), out);
+    std::fwrite(records.data(), 1, records.size(), out);
+    std::fclose(out);
+}
+
+static std::vector<unsigned char> record(uint16_t op, uint16_t argc, uint32_t blob_size, size_t payload) {
+    gltrace::RecordHeader header = {op, argc, blob_size};
+    std::vector<unsigned char> bytes(sizeof(header) + payload, 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    return bytes;
+}
+
+/* a record of args and a zeroed blob of blob_size bytes, padded to 8 */
+static std::vector<unsigned char> record(gltrace::Op op, std::vector<uint64_t> args, uint32_t blob_size) {
+    std::vector<unsigned char> bytes = record(uint16_t(op), uint16_t(args.size()), blob_size,
+                                              sizeof(uint64_t) * args.size() + ((blob_size + 7) & ~7u));
+    std::memcpy(bytes.data() + sizeof(gltrace::RecordHeader), args.data(), sizeof(uint64_t) * args.size());
+    return bytes;
+}
+
+
+TEST(TraceFile, ReadsRecords) {
+    std::vector<unsigned char> records = record(uint16_t(gltrace::Op::Clear), 1, 0, 8);
+    std::vector<unsigned char> frame = record(uint16_t(gltrace::Op::Frame), 0, 0, 0);
+    records.insert(records.end(), frame.begin(), frame.end());
+    writeTrace("test_records.trace", records);
+    {
+        gltrace::TraceFile trace("test_records.trace");
+        size_t offset = trace.begin();
+        EXPECT_EQ(trace.next(offset).op, gltrace::Op::Clear);
+        EXPECT_EQ(trace.next(offset).op, gltrace::Op::Frame);
+        EXPECT_EQ(offset, trace.end());
+    }
+    std::remove("test_records.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsTruncatedHeader) {
+    writeTrace("test_header.trace", {0, 0, 0});
+    gltrace::TraceFile trace("test_header.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record header");
+    std::remove("test_header.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsArgumentsPastTheEnd) {
+    writeTrace("test_argc.trace", record(uint16_t(gltrace::Op::Viewport), 4, 0, 16));
+    gltrace::TraceFile trace("test_argc.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_argc.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsBlobPastTheEnd) {
+    writeTrace("test_blob.trace", record(uint16_t(gltrace::Op::BufferData), 0, 0xFFFFFFFFu, 8));
+    gltrace::TraceFile trace("test_blob.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_blob.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsUnknownOp) {
+    writeTrace("test_op.trace", record(uint16_t(gltrace::Op::Count), 0, 0, 0));
+    gltrace::TraceFile trace("test_op.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "unknown op");
+    std::remove("test_op.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsMissingArguments) {
+    writeTrace("test_arguments.trace", record(uint16_t(gltrace::Op::TexImage2D), 0, 0, 0));
+    gltrace::TraceFile trace("test_arguments.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_arguments.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsShortBufferData) {
+    writeTrace("test_buffer.trace", record(gltrace::Op::BufferData, {GL_ARRAY_BUFFER, 64, GL_STATIC_DRAW, 1}, 8));
+    gltrace::TraceFile trace("test_buffer.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_buffer.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsShortBufferSubData) {
+    writeTrace("test_subdata.trace", record(gltrace::Op::BufferSubData, {GL_ARRAY_BUFFER, 0, 16}, 8));
+    gltrace::TraceFile trace("test_subdata.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_subdata.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsShortNames) {
+    writeTrace("test_names.trace", record(gltrace::Op::GenBuffers, {4}, 8));
+    gltrace::TraceFile trace("test_names.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_names.trace");
+}
+
+TEST(TraceFile, AcceptsBufferDataWithoutData) {
+    writeTrace("test_storage.trace", record(gltrace::Op::BufferData, {GL_ARRAY_BUFFER, 64, GL_STATIC_DRAW, 0}, 0));
+    {
+        gltrace::TraceFile trace("test_storage.trace");
+        size_t offset = trace.begin();
+        EXPECT_EQ(trace.next(offset).op, gltrace::Op::BufferData);
+    }
+    std::remove("test_storage.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsShortPixels) {
+    std::vector<unsigned char> records = record(gltrace::Op::TexSubImage2D,
+                                                {GL_TEXTURE_2D, 0, 0, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE}, 64);
+    std::vector<unsigned char> image = record(gltrace::Op::TexImage2D,
+                                              {GL_TEXTURE_2D, 0, GL_RGBA8, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE}, 32);
+    records.insert(records.end(), image.begin(), image.end());
+    writeTrace("test_pixels.trace", records);
+    gltrace::TraceFile trace("test_pixels.trace");
+    size_t offset = trace.begin();
+    gltrace::Record sub_image = trace.next(offset);
+    gltrace::Record short_image = trace.next(offset);
+
+    gltrace::UnpackState unpack;
+    trace.requirePixels(sub_image, unpack); // 4 rows of 16 bytes
+    EXPECT_EXIT(trace.requirePixels(short_image, unpack), ::testing::ExitedWithCode(EXIT_FAILURE),
+                "truncated record");
+    unpack.pixelStore(GL_UNPACK_ROW_LENGTH, 8);
+    EXPECT_EXIT(trace.requirePixels(sub_image, unpack), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_pixels.trace");
+}
+
+TEST(UnpackState, ImageSize) {
+    gltrace::UnpackState unpack;
+    EXPECT_EQ(unpack.imageSize(3, 2, GL_RGB, GL_UNSIGNED_BYTE), 12u + 9u); // rows padded to 4 bytes
+    unpack.pixelStore(GL_UNPACK_ALIGNMENT, 3); // rejected by gl
+    EXPECT_EQ(unpack.imageSize(3, 2, GL_RGB, GL_UNSIGNED_BYTE), 12u + 9u);
+    unpack.pixelStore(GL_UNPACK_ALIGNMENT, 1);
+    EXPECT_EQ(unpack.imageSize(3, 2, GL_RGB, GL_UNSIGNED_BYTE), 9u + 9u);
+    unpack.pixelStore(GL_UNPACK_ROW_LENGTH, 5);
+    unpack.pixelStore(GL_UNPACK_SKIP_ROWS, 1);
+    unpack.pixelStore(GL_UNPACK_SKIP_PIXELS, 2);
+    EXPECT_EQ(unpack.imageSize(3, 2, GL_RGB, GL_UNSIGNED_BYTE), 2 * 15u + (2 + 3) * 3u);
+    EXPECT_EQ(unpack.imageSize(1, 1, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV), 1 * 20u + (2 + 1) * 4u);
+    EXPECT_EQ(unpack.imageSize(0, 2, GL_RGB, GL_UNSIGNED_BYTE), 0u);
+    EXPECT_EQ(unpack.imageSize(-1, 2, GL_RGB, GL_UNSIGNED_BYTE), UINT64_MAX);
+    EXPECT_EQ(gltrace::UnpackState().imageSize(0x7FFFFFFF, 0x7FFFFFFF, GL_RGBA, GL_FLOAT), UINT64_MAX);
+}
+
+TEST(TraceFileDeathTest, RejectsShortMultiDraw) {
+    // 2 draws need 2 offsets, 2 counts & 2 base vertices
+    writeTrace("test_multidraw.trace",
+               record(gltrace::Op::MultiDrawElementsBaseVertex, {GL_TRIANGLES, GL_UNSIGNED_INT, 2}, 24));
+    gltrace::TraceFile trace("test_multidraw.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_multidraw.trace");
+}
+
+TEST(TraceFileDeathTest, RejectsShortUniformMatrix) {
+    writeTrace("test_matrix.trace", record(gltrace::Op::UniformMatrix4fv, {0, 1, GL_FALSE}, 32));
+    gltrace::TraceFile trace("test_matrix.trace");
+    size_t offset = trace.begin();
+    EXPECT_EXIT(trace.next(offset), ::testing::ExitedWithCode(EXIT_FAILURE), "truncated record");
+    std::remove("test_matrix.trace");
+}